@@ -0,0 +1,252 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include "ThreadPool.hh"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace std;
+
+#define URING_ENTRIES 256
+/* Threads Running io_uring Completion Callbacks, Apart from the Reaper */
+#define URING_CALLBACK_THREADS 1
+
+struct ReadRequest {
+    int fd;
+    uint64_t offset;
+    uint32_t length;
+    char *buf;
+    /* Bytes Read, or -errno; Invoked on an Engine Thread, Which May Submit Again */
+    function<void(ssize_t)> done;
+};
+
+/* Read Whole Range, Retrying Short Reads */
+static ssize_t preadFully(int fd, char *buf, uint32_t length, uint64_t offset) {
+    uint32_t got = 0;
+    while (got < length) {
+        ssize_t n = pread(fd, buf + got, length - got, offset + got);
+        if (n < 0) { if (errno == EINTR) { continue; } return -errno; }
+        if (n == 0) { break; }
+        got += n;
+    }
+    return got;
+}
+
+class ReadEngine {
+public:
+    virtual ~ReadEngine() {}
+    /* Queue Every Request at Once; Each Completes Independently */
+    virtual void submit(vector<ReadRequest> &reqs) = 0;
+    virtual const char *name() const = 0;
+};
+
+/* Fallback: Blocking pread() Spread over a Thread Pool */
+class PreadEngine : public ReadEngine {
+private:
+    ThreadPool pool;
+public:
+    explicit PreadEngine(uint32_t threads): pool(threads) {}
+
+    void submit(vector<ReadRequest> &reqs) override {
+        for (auto &r : reqs) {
+            pool.post([r]() { r.done(preadFully(r.fd, r.buf, r.length, r.offset)); });
+        }
+    }
+
+    const char *name() const override { return "pread"; }
+};
+
+#ifdef HAVE_IO_URING
+/* Raw io_uring Without liburing: Callers Fill the Submission Ring, One Thread Reaps, Another Runs Callbacks */
+class UringEngine : public ReadEngine {
+private:
+    int ringFd;
+    io_uring_params params;
+    void *sqPtr, *cqPtr;
+    size_t sqLen, cqLen;
+    io_uring_sqe *sqes;
+    unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+    unsigned *cqHead, *cqTail, *cqMask;
+    io_uring_cqe *cqes;
+
+    mutex submitLock;
+    mutex inflightLock;
+    condition_variable inflightCond;
+    uint32_t inflight;
+    atomic<bool> stopping;
+    ThreadPool callbacks;
+    thread reaper;
+
+    static int enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+        return syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0);
+    }
+
+    /* Caller Holds submitLock; false If the Kernel Refused Some SQEs, Which Are Then Read with pread */
+    bool flush(unsigned n) {
+        while (n) {
+            int ret = enter(ringFd, n, 0, 0);
+            if (ret < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY) { this_thread::yield(); continue; }
+                unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE), tail = *sqTail;
+                for (; head != tail; ++head) {
+                    ReadRequest *r = (ReadRequest *)sqes[sqArray[head & *sqMask]].user_data;
+                    if (r) { complete(r, -EINVAL); }
+                }
+                __atomic_store_n(sqTail, *sqHead, __ATOMIC_RELEASE);
+                return false;
+            }
+            n -= ret;
+        }
+        return true;
+    }
+
+    void push(uint8_t opcode, const ReadRequest *r) {
+        unsigned tail = *sqTail, idx = tail & *sqMask;
+        io_uring_sqe *sqe = &sqes[idx];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        if (r) {
+            sqe->fd = r->fd;
+            sqe->off = r->offset;
+            sqe->addr = (uint64_t)r->buf;
+            sqe->len = r->length;
+        }
+        else { sqe->fd = -1; }
+        sqe->user_data = (uint64_t)r;
+        sqArray[idx] = idx;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+    }
+
+    /* r Stops Counting Against the Completion Ring at Once; Its Callback Runs on the Callback Thread */
+    void complete(ReadRequest *r, int res) {
+        { lock_guard<mutex> g(inflightLock); --inflight; }
+        inflightCond.notify_all();
+        callbacks.post([r, res]() {
+            ssize_t n = res;
+            /* Kernels Without IORING_OP_READ Reject It, as Does flush() for SQEs It Pulls Back; Short Reads Are Finished by Hand */
+            if (n == -EINVAL) { n = preadFully(r->fd, r->buf, r->length, r->offset); }
+            else if (n >= 0 && uint32_t(n) < r->length) {
+                ssize_t rest = preadFully(r->fd, r->buf + n, r->length - n, r->offset + n);
+                if (rest > 0) { n += rest; }
+            }
+            r->done(n);
+            delete r;
+        });
+    }
+
+    void reap() {
+        bool woken = false;
+        while (true) {
+            /* A Ring That Fails Hard Cannot Deliver the NOP Either; Count That as Woken */
+            if (enter(ringFd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) { woken = true; }
+            unsigned head = *cqHead, tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head) {
+                io_uring_cqe *cqe = &cqes[head & *cqMask];
+                ReadRequest *r = (ReadRequest *)cqe->user_data;
+                int res = cqe->res;
+                __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+                if (r) { complete(r, res); }
+                else { woken = true; }
+            }
+            if (woken && stopping) {
+                lock_guard<mutex> g(inflightLock);
+                if (inflight == 0) { return; }
+            }
+        }
+    }
+
+public:
+    UringEngine(): ringFd(-1), sqPtr(MAP_FAILED), cqPtr(MAP_FAILED), sqes((io_uring_sqe *)MAP_FAILED), inflight(0), stopping(false),
+                   callbacks(URING_CALLBACK_THREADS) {
+        memset(&params, 0, sizeof(params));
+        ringFd = syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+        if (ringFd < 0) { return; }
+
+        sqLen = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqLen = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) { sqLen = cqLen = max(sqLen, cqLen); }
+        sqPtr = mmap(nullptr, sqLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+        if (sqPtr == MAP_FAILED) { return; }
+        cqPtr = single ? sqPtr : mmap(nullptr, cqLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        if (cqPtr == MAP_FAILED) { return; }
+        sqes = (io_uring_sqe *)mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+                                    MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) { return; }
+
+        char *sq = (char *)sqPtr, *cq = (char *)cqPtr;
+        sqHead = (unsigned *)(sq + params.sq_off.head);
+        sqTail = (unsigned *)(sq + params.sq_off.tail);
+        sqMask = (unsigned *)(sq + params.sq_off.ring_mask);
+        sqArray = (unsigned *)(sq + params.sq_off.array);
+        cqHead = (unsigned *)(cq + params.cq_off.head);
+        cqTail = (unsigned *)(cq + params.cq_off.tail);
+        cqMask = (unsigned *)(cq + params.cq_off.ring_mask);
+        cqes = (io_uring_cqe *)(cq + params.cq_off.cqes);
+
+        reaper = thread(&UringEngine::reap, this);
+    }
+
+    ~UringEngine() {
+        if (reaper.joinable()) {
+            stopping = true;
+            /* A NOP Wakes the Reaper; It Leaves once Nothing Is in Flight */
+            { lock_guard<mutex> g(submitLock); push(IORING_OP_NOP, nullptr); flush(1); }
+            reaper.join();
+        }
+        if (sqes != MAP_FAILED) { munmap(sqes, params.sq_entries * sizeof(io_uring_sqe)); }
+        if (cqPtr != MAP_FAILED && cqPtr != sqPtr) { munmap(cqPtr, cqLen); }
+        if (sqPtr != MAP_FAILED) { munmap(sqPtr, sqLen); }
+        if (ringFd >= 0) { close(ringFd); }
+    }
+
+    bool ok() const { return reaper.joinable(); }
+
+    void submit(vector<ReadRequest> &reqs) override {
+        lock_guard<mutex> g(submitLock);
+        unsigned queued = 0;
+        for (auto &r : reqs) {
+            /* Never Let Completions Outnumber the Completion Ring */
+            {
+                unique_lock<mutex> l(inflightLock);
+                if (inflight >= params.cq_entries) {
+                    l.unlock(); flush(queued); queued = 0; l.lock();
+                    inflightCond.wait(l, [this]() { return inflight < params.cq_entries; });
+                }
+                ++inflight;
+            }
+            push(IORING_OP_READ, new ReadRequest(r));
+            if (++queued == params.sq_entries) { flush(queued); queued = 0; }
+        }
+        flush(queued);
+    }
+
+    const char *name() const override { return "io_uring"; }
+};
+#endif
+
+/* io_uring When Asked for and Available, Otherwise the pread Pool */
+static unique_ptr<ReadEngine> makeReadEngine(bool useIoUring, uint32_t threads) {
+    #ifdef HAVE_IO_URING
+    if (useIoUring) {
+        unique_ptr<UringEngine> uring(new UringEngine());
+        if (uring->ok()) { return uring; }
+    }
+    #endif
+    return unique_ptr<ReadEngine>(new PreadEngine(threads));
+}
@@ -5,35 +5,141 @@
 #include <filesystem>
 #include <cmath>
 #include <fstream>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+#include <memory>
+#include <tuple>
+#include <set>
+#include <shared_mutex>
 #include "SkipList.hh"
 #include "bloom.hh"
+#include "Stats.hh"
+#include "RowCache.hh"
+#include "AsyncIO.hh"
+#include "WriteController.hh"
 
 using namespace std;
 using namespace std::filesystem;
 
+/* Target Size of the SSTs Compaction Cuts; the MemTable Budget Is Options::memTableBytes */
 #define MEM_MAX_BYTES (1 << 21)
+/* Offsets in an SST Are 32-Bit */
+#define SST_MAX_BYTES UINT32_MAX
+/* Size{4} + DataSegBias{4} + RangeSegBias{4} + FilterBytes{4} + LowBound{sizeof(K)} + HighBound{sizeof(K)} */
+#define SST_HEADER_BYTES(K) (16 + 2 * sizeof(K))
+/* Key{sizeof(K)} + dataBias{4} + dataLength{4} + EntryType{1} */
+#define INDEX_ENTRY_BYTES(K) (sizeof(K) + 9)
+/* Begin{sizeof(K)} + End{sizeof(K)} */
+#define RANGE_ENTRY_BYTES(K) (2 * sizeof(K))
+/* Each Subcompaction Gets at Least This Much Input, so Its Last, Partly Filled SST Stays a Minority */
+#define SUBCOMPACTION_MIN_BYTES (4 * MEM_MAX_BYTES)
+/* Every n-th Key of an Input Is a Candidate Split Point */
+#define SUBCOMPACTION_FENCE_STRIDE 256
 #define NUM_PER_LEVEL 4
 #define TIMES_PER_LEVEL 2
 #define MAX_SST_NUM(level) (NUM_PER_LEVEL * pow(2, (level)))
-#define GENERATE_FILENAME(dir, level, inLevel) ((dir) + '/' + to_string(level) + to_string(inLevel) + ".bin")
+/* Numbers Are Unique and Never Reused, so a File Keeps Its Name for Life */
+#define GENERATE_FILENAME(dir, level, number) ((dir) + '/' + to_string(level) + '-' + to_string(number) + ".bin")
+/* Names of the Files the Current Version Holds, One per Line; Anything Else Found at Open Was Obsolete or Unfinished */
+#define MANIFEST_NAME "MANIFEST"
 
-struct Bin {
-    Bin(char *_bin, uint32_t _length): bin(_bin), length(_length) {}
-    char *bin;
-    uint32_t length;
+/* Fields Sit at Any Offset in SSTs, so They Are Copied out Rather than Dereferenced in Place */
+template<class T>
+static T loadAs(const char *p) {
+    T ret;
+    memcpy(&ret, p, sizeof(T));
+    return ret;
+}
+
+/* Inverse of GENERATE_FILENAME on the Bare File Name; false for Anything Else */
+static bool parseFilename(const string &name, uint32_t *level, uint64_t *number) {
+    size_t dash = name.find('-');
+    if (dash == string::npos || dash == 0 || name.size() < dash + 6 || name.compare(name.size() - 4, 4, ".bin") != 0) { return false; }
+    string l = name.substr(0, dash), n = name.substr(dash + 1, name.size() - 4 - dash - 1);
+    auto digits = [](const string &str) { return all_of(str.begin(), str.end(), [](char c) { return c >= '0' && c <= '9'; }); };
+    if (!digits(l) || !digits(n)) { return false; }
+    *level = stoul(l); *number = stoull(n);
+    return true;
+}
+
+/* Deletes Every Key in [begin, end) Older than Itself */
+template<class K>
+struct RangeTombstone {
+    RangeTombstone(const K &b, const K &e): begin(b), end(e) {}
+    K begin;
+    K end;
+
+    bool operator<(const RangeTombstone<K> &ano) const { return begin < ano.begin; }
 };
 
+/* Sort and Merge Overlapping or Adjacent Ranges */
+template<class K>
+void coalesceRanges(vector<RangeTombstone<K> > &ranges) {
+    if (ranges.size() < 2) { return; }
+    sort(ranges.begin(), ranges.end());
+    auto last = ranges.begin();
+    for (auto i = ranges.begin() + 1; i != ranges.end(); ++i) {
+        if (i->begin <= last->end) { last->end = max(last->end, i->end); }
+        else { *(++last) = *i; }
+    }
+    ranges.erase(last + 1, ranges.end());
+}
+
+/* Ranges Must Be Coalesced */
+template<class K>
+bool rangesCover(const vector<RangeTombstone<K> > &ranges, const K &key) {
+    auto i = upper_bound(ranges.begin(), ranges.end(), RangeTombstone<K>(key, key));
+    return i != ranges.begin() && key < (--i)->end;
+}
+
+/* Whether a Single Range Deletes All of [low, high]; Ranges Must Be Coalesced */
+template<class K>
+bool rangesCoverAll(const vector<RangeTombstone<K> > &ranges, const K &low, const K &high) {
+    auto i = upper_bound(ranges.begin(), ranges.end(), RangeTombstone<K>(low, low));
+    return i != ranges.begin() && high < (--i)->end;
+}
+
+template<class K>
+vector<RangeTombstone<K> > parseRanges(const char *bin, uint32_t length) {
+    vector<RangeTombstone<K> > ret;
+    for (const char *p = bin; p - bin < length; p += RANGE_ENTRY_BYTES(K)) {
+        ret.push_back(RangeTombstone<K>(loadAs<K>(p), loadAs<K>(p + sizeof(K))));
+    }
+    return ret;
+}
+
+/* The Parts of an SST Indices Load on First Use */
+enum LazySegment { SEGMENT_FILTER = 0, SEGMENT_INDEX = 1 };
+
 template<class K>
 class Indices {
 private:
+    /* Read from the File on First Use and Shared by Every Copy, so Opening Touches Headers Only */
+    struct Lazy {
+        once_flag filterOnce;
+        once_flag indexOnce;
+        /* Set Once the Matching once_flag's Load Is Done */
+        atomic<bool> filterReady{false};
+        atomic<bool> indexReady{false};
+        bloom filter;
+        vector<RangeTombstone<K> > ranges;
+        vector<K> key;
+        vector<uint32_t> bias;
+        vector<uint32_t> length;
+        vector<EntryType> type;
+    };
+
     uint32_t size;
     uint32_t dataSegBias;
-    vector<K> key;
-    vector<uint32_t> bias;
-    vector<uint32_t> length;
-    bloom filter;
+    uint32_t rangeSegBias;
+    uint32_t filterBytes;
+    K lowBound;
+    K highBound;
+    bool bounded;
+    shared_ptr<Lazy> lazy;
 
-    uint32_t binarySearch(K a[], int n , K target) {
+    static uint32_t binarySearch(const K a[], int n , K target) {
 	    int low = 0, high = n - 1, middle;
 	    while(low <= high) {
 	        middle = (low + high) / 2;
@@ -43,400 +149,926 @@ private:
 	    }
 	    return -1;
     }
+
+    static void readSegment(const string &filename, uint32_t offset, uint32_t length, char *buf) {
+        int fd = open(filename.c_str(), O_RDONLY); assert(fd >= 0);
+        ssize_t n = preadFully(fd, buf, length, offset);
+        close(fd);
+        assert(n == length);
+    }
+
+    /* Range Tombstones and Filter Sit Together at the Tail */
+    void parseFilter(const char *buf) const {
+        uint32_t rangeBytes = size - rangeSegBias - filterBytes;
+        lazy->ranges = parseRanges<K>(buf, rangeBytes);
+        lazy->filter.load(buf + rangeBytes, filterBytes);
+        lazy->filterReady.store(true, memory_order_release);
+    }
+
+    void parseIndex(const char *buf) const {
+        for (const char *indices = buf; indices != buf + segmentLength(SEGMENT_INDEX); ) {
+            lazy->key.push_back(loadAs<K>(indices)); indices += sizeof(K);
+            lazy->bias.push_back(loadAs<uint32_t>(indices)); indices += 4;
+            lazy->length.push_back(loadAs<uint32_t>(indices)); indices += 4;
+            lazy->type.push_back(EntryType(loadAs<uint8_t>(indices))); indices += 1;
+        }
+        lazy->indexReady.store(true, memory_order_release);
+    }
+
+    void loadFilter(const string &filename) const {
+        call_once(lazy->filterOnce, [&]() {
+            vector<char> buf(segmentLength(SEGMENT_FILTER));
+            readSegment(filename, segmentOffset(SEGMENT_FILTER), buf.size(), buf.data());
+            parseFilter(buf.data());
+        });
+    }
+
+    void loadIndex(const string &filename) const {
+        call_once(lazy->indexOnce, [&]() {
+            vector<char> buf(segmentLength(SEGMENT_INDEX));
+            readSegment(filename, segmentOffset(SEGMENT_INDEX), buf.size(), buf.data());
+            parseIndex(buf.data());
+        });
+    }
+
 public:
-    explicit Indices(const Bin &bin, uint32_t _size, uint32_t _dataSegBias)
-        : size(_size), dataSegBias(_dataSegBias) {
-        char *indices = bin.bin;
-        while (indices - bin.bin < bin.length) {
-            K k = *(K *)indices; indices += sizeof(K);
-            uint32_t datumBias = *(uint32_t *)indices; indices += 4;
-            uint32_t datumLen = *(uint32_t *)indices; indices += 4;
-            filter.insert(k);
-            key.push_back(k);
-            bias.push_back(datumBias);
-            length.push_back(datumLen);
-        }
-    }
-
-    bool find(const K &k, uint32_t *b = nullptr, uint32_t *l = nullptr) {
-        if (filter.isExist(k)) {
-            uint32_t pos = binarySearch(key.data(), key.size(), k);
+    Indices(): size(0), dataSegBias(0), rangeSegBias(0), filterBytes(0), lowBound(), highBound(), bounded(false), lazy(make_shared<Lazy>()) {}
+
+    /* Built in Memory Alongside Its Table, Entries Coming Through add(); Nothing Is Ever Read Back */
+    explicit Indices(const vector<RangeTombstone<K> > &_ranges, uint32_t _size, uint32_t _dataSegBias)
+        : size(_size), dataSegBias(_dataSegBias), filterBytes(FILTER_BYTES((_dataSegBias - SST_HEADER_BYTES(K)) / INDEX_ENTRY_BYTES(K))),
+          lowBound(), highBound(), bounded(!_ranges.empty()), lazy(make_shared<Lazy>()) {
+        rangeSegBias = size - filterBytes - _ranges.size() * RANGE_ENTRY_BYTES(K);
+        call_once(lazy->filterOnce, [this]() { lazy->filterReady = true; });
+        call_once(lazy->indexOnce, [this]() { lazy->indexReady = true; });
+        lazy->filter.reset(filterBytes);
+        lazy->ranges = _ranges;
+        if (bounded) { lowBound = _ranges.front().begin; highBound = _ranges.back().end; }
+    }
+
+    /* From an SST Header Alone; Filter and Index Follow When a Lookup First Needs Them */
+    explicit Indices(const char *header)
+        : size(loadAs<uint32_t>(header)), dataSegBias(loadAs<uint32_t>(header + 4)), rangeSegBias(loadAs<uint32_t>(header + 8)),
+          filterBytes(loadAs<uint32_t>(header + 12)), lowBound(loadAs<K>(header + 16)), highBound(loadAs<K>(header + 16 + sizeof(K))),
+          bounded(true), lazy(make_shared<Lazy>()) {}
+
+    /* Keys Must Arrive in Increasing Order */
+    void add(const K &k, uint32_t datumBias, uint32_t datumLen, EntryType t) {
+        lazy->filter.insert(k);
+        lazy->key.push_back(k);
+        lazy->bias.push_back(datumBias);
+        lazy->length.push_back(datumLen);
+        lazy->type.push_back(t);
+        if (!bounded) { lowBound = highBound = k; bounded = true; }
+        else { lowBound = min(lowBound, k); highBound = max(highBound, k); }
+    }
+
+    /* Whether k Lies Within the File's Bounds; Answered Without Any I/O */
+    bool spans(const K &k) const { return bounded && !(k < lowBound) && !(highBound < k); }
+
+    /* filename Is Only Read the First Time Filter or Index Are Needed */
+    bool find(const K &k, const string &filename, uint32_t *b = nullptr, uint32_t *l = nullptr, EntryType *t = nullptr, Statistics *stats = nullptr) const {
+        if (!spans(k)) { return false; }
+        loadFilter(filename);
+        if (stats) { stats->bloomProbes.fetch_add(1, memory_order_relaxed); }
+        if (lazy->filter.isExist(k)) {
+            loadIndex(filename);
+            uint32_t pos = binarySearch(lazy->key.data(), lazy->key.size(), k);
             if (pos != -1) {
-                if (b) { *b = bias.at(pos); }
-                if (l) { *l = length.at(pos); }
+                if (b) { *b = lazy->bias.at(pos); }
+                if (l) { *l = lazy->length.at(pos); }
+                if (t) { *t = lazy->type.at(pos); }
                 return true;
             }
+            if (stats) { stats->bloomFalsePositives.fetch_add(1, memory_order_relaxed); }
         }
+        else if (stats) { stats->bloomTrueNegatives.fetch_add(1, memory_order_relaxed); }
 
         return false;
     }
 
+    /* Load s Through a ReadEngine: Whether It Is Still on Disk, Where, and Handing Its Bytes Back */
+    bool loaded(LazySegment s) const { return (s == SEGMENT_FILTER ? lazy->filterReady : lazy->indexReady).load(memory_order_acquire); }
+    uint32_t segmentOffset(LazySegment s) const { return s == SEGMENT_FILTER ? rangeSegBias : SST_HEADER_BYTES(K); }
+    uint32_t segmentLength(LazySegment s) const { return s == SEGMENT_FILTER ? size - rangeSegBias : dataSegBias - SST_HEADER_BYTES(K); }
+    void install(LazySegment s, const char *buf) const {
+        if (s == SEGMENT_FILTER) { call_once(lazy->filterOnce, [&]() { parseFilter(buf); }); }
+        else { call_once(lazy->indexOnce, [&]() { parseIndex(buf); }); }
+    }
+
+    /* Whether k Passes the Filter, Which Must Be Loaded; Not Counted in Statistics */
+    bool mayContain(const K &k) const { return spans(k) && lazy->filter.isExist(k); }
+
     uint32_t getSize() const { return size; }
     uint32_t getDataSegBias() const { return dataSegBias; }
 
-    uint32_t getLowBound() const { return key.front(); }
-    uint32_t getHighBound() const { return key.back(); }
+    /* Whether a Range Tombstone of This File Deletes k */
+    bool covers(const K &k, const string &filename) const {
+        if (!spans(k)) { return false; }
+        loadFilter(filename);
+        return rangesCover(lazy->ranges, k);
+    }
+
+    /* Bounds Span Both Keys and Range Tombstones; a Range End Counts as Inclusive Here */
+    K getLowBound() const { return lowBound; }
+    K getHighBound() const { return highBound; }
 
 };
 
+/* Read Just the Header of an SST File; nullptr If It Does Not Describe the File */
+template<class K>
+unique_ptr<Indices<K> > loadIndices(const string &filename) {
+    error_code ec;
+    uintmax_t fileBytes = file_size(filename, ec);
+    if (ec || fileBytes < SST_HEADER_BYTES(K)) { return nullptr; }
+    char header[SST_HEADER_BYTES(K)];
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) { return nullptr; }
+    ssize_t n = preadFully(fd, header, SST_HEADER_BYTES(K), 0);
+    close(fd);
+    if (n != SST_HEADER_BYTES(K)) { return nullptr; }
+
+    uint32_t size = loadAs<uint32_t>(header), dataSegBias = loadAs<uint32_t>(header + 4), rangeSegBias = loadAs<uint32_t>(header + 8);
+    uint32_t filterBytes = loadAs<uint32_t>(header + 12);
+    if (size != fileBytes || dataSegBias < SST_HEADER_BYTES(K) || rangeSegBias < dataSegBias || size < rangeSegBias) { return nullptr; }
+    if (filterBytes == 0 || size - rangeSegBias < filterBytes) { return nullptr; }
+    uint32_t idxBytes = dataSegBias - SST_HEADER_BYTES(K), rangeBytes = size - filterBytes - rangeSegBias;
+    if (idxBytes % INDEX_ENTRY_BYTES(K) || rangeBytes % RANGE_ENTRY_BYTES(K) || idxBytes + rangeBytes == 0) { return nullptr; }
+    return unique_ptr<Indices<K> >(new Indices<K>(header));
+}
+
+
+/* Bytes Staged Before Each pwrite(), Split Between the Two Streams; Page-Aligned and Reused from One Table to the Next */
+#define TABLE_BUFFER_BYTES (1 << 20)
+#define TABLE_BUFFER_ALIGN 4096
+
+/* Streams an SST into Its File in One Ordered Pass, Header Last; Reusable from One Table to the Next */
+template<class K, class V>
+class TableBuilder {
+private:
+    struct Stream {
+        char *buf;
+        uint32_t used;
+        uint64_t offset;
+    };
+
+    char *buf;
+    Stream indexStream, dataStream;
+    bloom filter;
+    int fd;
+    bool ok;
+
+    void drain(Stream &s) {
+        uint32_t done = 0;
+        while (ok && done < s.used) {
+            ssize_t n = pwrite(fd, s.buf + done, s.used - done, s.offset + done);
+            if (n < 0) {
+                if (errno == EINTR) { continue; }
+                ok = false;
+            }
+            else { done += n; }
+        }
+        s.offset += s.used;
+        s.used = 0;
+    }
+
+    void append(Stream &s, const void *src, uint32_t n) {
+        const char *p = (const char *)src;
+        while (n) {
+            uint32_t chunk = min(n, TABLE_BUFFER_BYTES / 2 - s.used);
+            memcpy(s.buf + s.used, p, chunk);
+            s.used += chunk; p += chunk; n -= chunk;
+            if (s.used == TABLE_BUFFER_BYTES / 2) { drain(s); }
+        }
+    }
+
+public:
+    TableBuilder(): buf((char *)aligned_alloc(TABLE_BUFFER_ALIGN, TABLE_BUFFER_BYTES)), fd(-1), ok(false) {}
+    ~TableBuilder() { free(buf); }
+    TableBuilder(const TableBuilder<K, V> &) = delete;
+    TableBuilder<K, V> &operator=(const TableBuilder<K, V> &) = delete;
+
+    /* visit(f) Must Call f(entry) on Each of the n Entries in Key Order. When idx Is Given,
+     * It Receives the Table's Indices. false If the File Cannot Be Written; Any Old filename Is Then Untouched */
+    template<class Visit>
+    bool build(const string &filename, uint32_t n, uint32_t dataBytes, const vector<RangeTombstone<K> > &ranges,
+               Visit visit, Indices<K> *idx = nullptr) {
+        if (!buf) { return false; }
+        uint32_t dataSegBias = SST_HEADER_BYTES(K) + n * INDEX_ENTRY_BYTES(K);
+        uint32_t rangeSegBias = dataSegBias + dataBytes;
+        uint32_t filterBytes = FILTER_BYTES(n);
+        uint32_t size = rangeSegBias + ranges.size() * RANGE_ENTRY_BYTES(K) + filterBytes;
+        /* Renamed into Place When Done, so a Rewrite Is a New Inode */
+        string tmp = filename + ".tmp";
+        fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) { return false; }
+        ok = true;
+        indexStream = Stream{ buf, 0, SST_HEADER_BYTES(K) };
+        dataStream = Stream{ buf + TABLE_BUFFER_BYTES / 2, 0, dataSegBias };
+        if (idx) { *idx = Indices<K>(ranges, size, dataSegBias); }
+        filter.reset(filterBytes);
+        bool bounded = !ranges.empty();
+        K low = bounded ? ranges.front().begin : K(), high = bounded ? ranges.back().end : K();
+
+        /* Set Indices and Datum Segments */
+        uint32_t pos = 0;
+        visit([&](const Entry<K, V> &e) {
+            uint32_t len = 0;
+            uint8_t t = e.type;
+            /* String Limited */
+            #ifdef STRING
+            len = e.value.size();
+            append(dataStream, e.value.data(), len);
+            #endif
+            append(indexStream, &e.key, sizeof(K)); append(indexStream, &pos, 4);
+            append(indexStream, &len, 4); append(indexStream, &t, 1);
+            if (idx) { idx->add(e.key, pos, len, e.type); }
+            filter.insert(e.key);
+            if (!bounded) { low = high = e.key; bounded = true; }
+            else { low = min(low, e.key); high = max(high, e.key); }
+            pos += len;
+        });
+
+        /* Set Range Tombstone and Filter Segments */
+        for (auto &r : ranges) { append(dataStream, &r.begin, sizeof(K)); append(dataStream, &r.end, sizeof(K)); }
+        append(dataStream, filter.data(), filterBytes);
+
+        drain(indexStream);
+        drain(dataStream);
+        bool complete = pos == dataBytes && indexStream.offset == dataSegBias && dataStream.offset == size;
+
+        /* Set Header Segment Last, Once the Bounds Are Known */
+        indexStream = Stream{ buf, 0, 0 };
+        append(indexStream, &size, 4); append(indexStream, &dataSegBias, 4); append(indexStream, &rangeSegBias, 4);
+        append(indexStream, &filterBytes, 4); append(indexStream, &low, sizeof(K)); append(indexStream, &high, sizeof(K));
+        drain(indexStream);
+
+        if (close(fd) != 0) { ok = false; }
+        fd = -1;
+        error_code ec;
+        if (ok && complete) { rename(tmp, filename, ec); }
+        if (!ok || !complete || ec) { std::filesystem::remove(tmp, ec); return false; }
+        return true;
+    }
+};
 
 template<class K, class V>
 class SST {
 private:
     vector<Entry<K, V> > data;
+    vector<RangeTombstone<K> > ranges;
     uint32_t size;
     uint32_t dataSegBias;
+    uint32_t rangeSegBias;
     uint32_t dataBytes;
-    char *bin;
+
+    /* Header{SST_HEADER_BYTES(K)} + Indices{n * (sizeof(K) + dataBias{4} + dataLength{4} + EntryType{1})}
+     * + Datum{dataBytes} + Ranges{m * (begin{sizeof(K)} + end{sizeof(K)})} + Filter{FILTER_BYTES(n)} */
+    void layout() {
+        dataSegBias = SST_HEADER_BYTES(K) + data.size() * INDEX_ENTRY_BYTES(K);
+        rangeSegBias = dataSegBias + dataBytes;
+        size = rangeSegBias + ranges.size() * RANGE_ENTRY_BYTES(K) + FILTER_BYTES(data.size());
+    }
 
 public:
-    /* From Memory to Disk */
-    explicit SST(const vector<Entry<K, V> > &_data, uint32_t _dataBytes): data(_data), dataBytes(_dataBytes), bin(nullptr) { toBin(); }
-    explicit SST(const SST<K, V> & ano): data(ano.data), size(ano.size), dataSegBias(ano.dataSegBias), dataBytes(ano.dataBytes) {
-        bin = new char[size];
-        memcpy(bin, ano.bin, size);
-    }
-
-    /* From Disk to Memory */
-    explicit SST(char *_bin): bin(_bin) {
-        size = *(uint32_t *)_bin;   /* Unused */
-        dataSegBias = *(uint32_t *)(_bin + 4);
-        char *indices = _bin + 8;
-        char *datum = _bin + dataSegBias; _bin = datum;
+    /* From Memory to Disk; Serialized Only When Written, by a TableBuilder */
+    explicit SST(vector<Entry<K, V> > _data, uint32_t _dataBytes, const vector<RangeTombstone<K> > &_ranges = vector<RangeTombstone<K> >())
+        : data(move(_data)), ranges(_ranges), dataBytes(_dataBytes) { layout(); }
+
+    /* From Disk to Memory; Values Are Copied out, so the Caller May Free bin Right Away */
+    explicit SST(const char *bin) {
+        size = loadAs<uint32_t>(bin);
+        dataSegBias = loadAs<uint32_t>(bin + 4);
+        rangeSegBias = loadAs<uint32_t>(bin + 8);
+        ranges = parseRanges<K>(bin + rangeSegBias, size - loadAs<uint32_t>(bin + 12) - rangeSegBias);
+        const char *indices = bin + SST_HEADER_BYTES(K);
+        const char *datum = bin + dataSegBias, *end = datum;
         /* String Limited */
         #ifdef STRING
         if (typeid(V) == typeid(string)) {
-            while (indices != _bin) {
-                K k = *(K *)indices; indices += sizeof(K);
+            while (indices != end) {
+                K k = loadAs<K>(indices); indices += sizeof(K);
                 indices += 4;    /* Unused Size */
-                uint32_t datumLen = *(uint32_t *)indices; indices += 4;
-                V v(datum, datumLen);
+                uint32_t datumLen = loadAs<uint32_t>(indices); indices += 4;
+                EntryType t = EntryType(loadAs<uint8_t>(indices)); indices += 1;
+                data.push_back(Entry<K, V>(k, V(datum, datumLen), t));
                 datum += datumLen;
-                data.push_back(Entry<K, V>(k, v));
             }
-
-            dataBytes = datum - _bin;
         }
         #endif
+        dataBytes = datum - end;
     }
-    ~SST() { if (bin) { delete []bin; } }
 
-    Bin toBin() {
-        uint32_t idxBytes = data.size() * (sizeof(K) + 8);
-        /* Size{4} + Bias{4} + Indices{n * (sizeof(K) + dataBias{4} + dataLength{4})} + Datum{dataBytes} */
-        uint32_t capacity = 8 + idxBytes + dataBytes;
+    vector<Entry<K, V> > &vecData() {
+        return data;
+    }
 
-        size = capacity;
-        dataSegBias = 8 + idxBytes;
+    vector<RangeTombstone<K> > &vecRanges() {
+        return ranges;
+    }
 
-        if (bin) { return Bin(bin, capacity); }
-        else {
-            char *ret = bin = new char[capacity];
+    Indices<K> toIndices() const {
+        Indices<K> ret(ranges, size, dataSegBias);
+        uint32_t pos = 0;
+        for (auto &e : data) {
+            uint32_t len = 0;
             /* String Limited */
             #ifdef STRING
-            if (typeid(V) == typeid(string)) {
-                /* Set Bias Segment */
-                *(uint32_t *)ret = capacity; ret += 4;
-
-                /* Set Bias Segment */
-                *(uint32_t *)ret = 8 + idxBytes; ret += 4;
-
-                /* Set Indices Segment */
-                uint32_t pos = 0;
-                for (uint32_t i = 0; i < data.size(); ++i) {
-                    *(K *)ret = data.at(i).key; ret += sizeof(K);
-                    *(uint32_t *)ret = pos; ret += 4;
-                    *(uint32_t *)ret = data.at(i).value.size(); ret +=4;
-                    pos += data.at(i).value.size();
-                }
-
-                /* Set Datum Segment */
-                for (uint32_t i = 0; i < data.size(); ++i) {
-                    V val = data.at(i).value;
-                    memcpy(ret, val.c_str(), val.size());
-                    ret += val.size();
-                }
-            }
+            len = e.value.size();
             #endif
+            ret.add(e.key, pos, len, e.type);
+            pos += len;
         }
-        return Bin(bin, capacity);
+        return ret;
     }
 
-    Bin toIndexBin() {
-        if (!bin) { toBin(); }
-        uint32_t idxCapacity = data.size() * (sizeof(K) + 8);
-        return Bin(bin + 8, idxCapacity);
-    }
-
-    vector<Entry<K, V> > &vecData() {
-        return data;
+    /* Stream to filename; the Builder's Buffer Is the Only Staging Memory */
+    bool write(const string &filename, TableBuilder<K, V> &builder) const {
+        return builder.build(filename, data.size(), dataBytes, ranges,
+                             [this](auto f) { for (auto &e : data) { f(e); } });
     }
 
     uint32_t getSize() const { return size; }
     uint32_t getDataSegBias() const { return dataSegBias; }
 
-    K getLowBound() const { return data.front().key; }
-    K getHighBound() const { return data.back().key; }
+    K getLowBound() const {
+        if (ranges.empty()) { return data.front().key; }
+        return data.empty() ? ranges.front().begin : min(data.front().key, ranges.front().begin);
+    }
+    K getHighBound() const {
+        if (ranges.empty()) { return data.back().key; }
+        return data.empty() ? ranges.back().end : max(data.back().key, ranges.back().end);
+    }
         
 };
 
+/* Builds an SST in the Engine's Format from Keys Added in Strictly Increasing Order, for LSM::ingestFiles() */
+template<class K, class V>
+class SSTWriter {
+private:
+    vector<Entry<K, V> > data;
+    uint64_t dataBytes;
+    TableBuilder<K, V> builder;
+
+    static uint64_t bytesFor(uint64_t n, uint64_t dataBytes) { return SST_HEADER_BYTES(K) + n * INDEX_ENTRY_BYTES(K) + dataBytes + FILTER_BYTES(n); }
+
+public:
+    SSTWriter(): dataBytes(0) {}
+
+    /* Return false, Adding Nothing, If key Does Not Follow the Last One or the File Would Pass SST_MAX_BYTES */
+    bool add(const K &key, const V &value, EntryType type = ENTRY_VALUE) {
+        if (!data.empty() && !(data.back().key < key)) { return false; }
+        uint64_t len = 0;
+        /* String Limited */
+        #ifdef STRING
+        len = value.size();
+        #endif
+        if (bytesFor(data.size() + 1, dataBytes + len) > SST_MAX_BYTES) { return false; }
+        data.push_back(Entry<K, V>(key, value, type));
+        dataBytes += len;
+        return true;
+    }
+
+    uint32_t size() const { return data.size(); }
+    /* Bytes the File Would Take; Cut Input at About MEM_MAX_BYTES to Match Compaction Output */
+    uint64_t fileBytes() const { return bytesFor(data.size(), dataBytes); }
+
+    /* Write Everything Added So Far and Start Over; false If Empty or the Write Fails */
+    bool finish(const string &filename) {
+        if (data.empty()) { return false; }
+        bool ok = builder.build(filename, data.size(), dataBytes, vector<RangeTombstone<K> >(),
+                                [this](auto f) { for (auto &e : data) { f(e); } });
+        data.clear(); dataBytes = 0;
+        return ok;
+    }
+};
+
+/* One SST on Disk; Once Marked Obsolete, It Is Deleted Along with the Last Version Holding It */
+template<class K>
+struct FileMeta {
+    FileMeta(const string &_filename, uint64_t _number, const Indices<K> &_idx)
+        : filename(_filename), number(_number), idx(_idx), obsolete(false) {}
+    ~FileMeta() {
+        if (obsolete) { error_code ec; std::filesystem::remove(filename, ec); }
+    }
+
+    string filename;
+    uint64_t number;
+    Indices<K> idx;
+    atomic<bool> obsolete;
+};
+
+/* Per-Level File Lists; Copies Share the Files, so the Writer Edits a Copy and Installs It in a New Version */
 template <class K>
 class IndicesTab {
 private:
-    string Dir;
-    vector<Indices<K> > chaosLevel;
-    vector<vector<Indices<K> > > orderedLevel;
+    /* Oldest First */
+    vector<shared_ptr<FileMeta<K> > > chaosLevel;
+    vector<vector<shared_ptr<FileMeta<K> > > > orderedLevel;
+    Statistics *stats;
 public:
-    explicit IndicesTab(const string &_dir): Dir(_dir) {
+    explicit IndicesTab(Statistics *_stats = nullptr): stats(_stats) {}
+
+    /* Only Headers Are Read Here, openThreads at a Time; Files a Manifest Does Not Name Are Deleted */
+    explicit IndicesTab(const string &_dir, Statistics *_stats = nullptr, uint32_t openThreads = 1): stats(_stats) {
         path dir(_dir);
         if (!exists(dir)) { assert(create_directory(dir)); }
+        set<string> live;
+        ifstream manifest(_dir + '/' + MANIFEST_NAME);
+        bool listed = bool(manifest);
+        for (string name; getline(manifest, name); ) { live.insert(name); }
 
-        /* Read Indices From Disk */
-        directory_iterator SSTs(dir);
-        int level = 0, inLevel = 0;
-        bool found = true;
-        while (found) {
-            string nextFile = GENERATE_FILENAME(_dir, level, inLevel);
-            found = exists(nextFile);
-            if (found) {
-                if (orderedLevel.size() < level) {
-                    orderedLevel.push_back(vector<Indices<K> >());
-                }
-                ifstream in(nextFile); assert(in);
-                char prefixBuf[8];
-                in.read(prefixBuf, 8);
-
-                uint32_t idxReadNum = *(uint32_t *)(prefixBuf + 4) - 8;
-                char *idxBuff = new char[idxReadNum];
-                in.read(idxBuff, idxReadNum);
-                in.close();
-                Indices<K> idx(Bin(idxBuff, idxReadNum), *(uint32_t *)prefixBuf, *(uint32_t *)(prefixBuf + 4));
-                if (level == 0 && inLevel < NUM_PER_LEVEL) { chaosLevel.push_back(idx); }
-                else if (inLevel < MAX_SST_NUM(level)) { orderedLevel.back().push_back(idx); }
-                ++inLevel;
-                if (inLevel == MAX_SST_NUM(level)) {
-                    ++level; inLevel = 0;
-                    orderedLevel.push_back(vector<Indices<K> >());
-                }
-                delete []idxBuff;
-            }
-            else if (inLevel != 0 || level == 0) { 
-                ++level; inLevel = 0; found = true;
+        /* Level and Number Come from the Name; Level 0 Age Follows the Number */
+        vector<tuple<uint32_t, uint64_t, string> > files;
+        for (auto &entry : directory_iterator(dir)) {
+            uint32_t level = 0; uint64_t number = 0;
+            string name = entry.path().filename().string();
+            /* Left by a Write a Crash Cut Short */
+            if (entry.path().extension() == ".tmp") { error_code ec; std::filesystem::remove(entry.path(), ec); continue; }
+            if (!parseFilename(name, &level, &number)) { continue; }
+            if (listed && !live.count(name)) { error_code ec; std::filesystem::remove(entry.path(), ec); continue; }
+            files.push_back(make_tuple(level, number, GENERATE_FILENAME(_dir, level, number)));
+        }
+        if (files.empty()) { return; }
+        sort(files.begin(), files.end());
+
+        /* Read Headers From Disk */
+        ThreadPool pool(min<size_t>(openThreads, files.size()));
+        vector<future<unique_ptr<Indices<K> > > > headers;
+        for (auto &f : files) {
+            string filename = get<2>(f);
+            headers.push_back(pool.submit([filename]() { return loadIndices<K>(filename); }));
+        }
+        for (size_t i = 0; i < files.size(); ++i) {
+            unique_ptr<Indices<K> > loaded = headers[i].get();
+            /* A Torn or Foreign File Is Set Aside as <name>.bad Rather than Failing the Open */
+            if (!loaded) {
+                error_code ec;
+                rename(get<2>(files[i]), get<2>(files[i]) + ".bad", ec);
+                if (stats) { stats->badFiles.fetch_add(1, memory_order_relaxed); }
+                continue;
             }
+            uint32_t level = get<0>(files[i]);
+            while (getHeight() <= level) { addNewLevel(); }
+            rLevel(level)->push_back(make_shared<FileMeta<K> >(get<2>(files[i]), get<1>(files[i]), *loaded));
         }
     }
 
-    bool insert(const Indices<K> &idx, string &filename) {
-        if (chaosLevel.size() == NUM_PER_LEVEL) { return false; }
-        filename = GENERATE_FILENAME(Dir, 0, chaosLevel.size());
-        chaosLevel.push_back(idx);
-        return true;
+    vector<shared_ptr<FileMeta<K> > > *rLevel(uint32_t levelNum) {
+        if (levelNum == 0) { return &chaosLevel; }
+        else { return &orderedLevel[levelNum - 1]; }
     }
-
-    vector<Indices<K> > *rLevel(uint32_t levelNum) {
+    const vector<shared_ptr<FileMeta<K> > > *rLevel(uint32_t levelNum) const {
         if (levelNum == 0) { return &chaosLevel; }
         else { return &orderedLevel[levelNum - 1]; }
     }
 
     uint32_t getHeight() const { return 1 + orderedLevel.size(); }
 
+    /* Replace dir's Manifest with the Files Held Here, Atomically by Rename */
+    bool saveManifest(const string &dir) const {
+        string tmp = dir + '/' + MANIFEST_NAME + ".tmp";
+        {
+            ofstream out(tmp, ios::trunc);
+            for (uint32_t l = 0; l < getHeight(); ++l) {
+                for (auto &f : *rLevel(l)) { out << path(f->filename).filename().string() << '\n'; }
+            }
+            if (!out.flush()) { return false; }
+        }
+        error_code ec;
+        rename(tmp, dir + '/' + MANIFEST_NAME, ec);
+        return !ec;
+    }
+
+    uint64_t maxFileNumber() const {
+        uint64_t ret = 0;
+        for (uint32_t l = 0; l < getHeight(); ++l) {
+            for (auto &f : *rLevel(l)) { ret = max(ret, f->number); }
+        }
+        return ret;
+    }
+
     bool find(const K &key, 
               string *filename = nullptr, uint32_t *dataSegBias= nullptr,
-              uint32_t *bias = nullptr, uint32_t *length = nullptr) {
+              uint32_t *bias = nullptr, uint32_t *length = nullptr, uint32_t *level = nullptr) const {
+        EntryType type;
         for (auto i = chaosLevel.rbegin(); i != chaosLevel.rend(); ++i) {
-            if (i->find(key, bias, length)) {
-                if (*length == 0) { return false; }
+            const Indices<K> &idx = (*i)->idx;
+            /* Bounds Come From the Header, so Files Off the Key Are Skipped Without Loading Them */
+            if (!idx.spans(key)) { continue; }
+            if (idx.find(key, (*i)->filename, bias, length, &type, stats)) {
+                /* The Newest Entry Is a Tombstone */
+                if (type == ENTRY_DELETION) { return false; }
                 else { 
-                    *filename = GENERATE_FILENAME(Dir, 0, chaosLevel.size() - 1 - (i - chaosLevel.rbegin()));
-                    *dataSegBias = i->getDataSegBias();
+                    *filename = (*i)->filename;
+                    *dataSegBias = idx.getDataSegBias();
+                    if (level) { *level = 0; }
                     return true; 
                 }
             }
+            /* Within One File, Points Are Newer than the Ranges Covering Them */
+            if (idx.covers(key, (*i)->filename)) { return false; }
         }
 
         for (auto i = orderedLevel.begin(); i != orderedLevel.end(); ++i) {
             for (auto j = i->begin(); j != i->end(); ++j) {
-                if (j->find(key, bias, length)) {
-                    if (*length == 0) { return false; }
-                    *filename = GENERATE_FILENAME(Dir, i - orderedLevel.begin() + 1, j - i->begin());
-                    *dataSegBias = j->getDataSegBias();
+                const Indices<K> &idx = (*j)->idx;
+                if (!idx.spans(key)) { continue; }
+                if (idx.find(key, (*j)->filename, bias, length, &type, stats)) {
+                    if (type == ENTRY_DELETION) { return false; }
+                    *filename = (*j)->filename;
+                    *dataSegBias = idx.getDataSegBias();
+                    if (level) { *level = i - orderedLevel.begin() + 1; }
                     return true; 
                 }
+                if (idx.covers(key, (*j)->filename)) { return false; }
             }
         }
 
         return false;
     }
 
-    void addNewLevel() { orderedLevel.push_back(vector<Indices<K> >()); }
+    void addNewLevel() { orderedLevel.push_back(vector<shared_ptr<FileMeta<K> > >()); }
     void clear() { chaosLevel.clear(); orderedLevel.clear(); }
 };
 
+/* A SkipList with Its Range Tombstones; the Writer Takes lock Alone, Readers Share It */
+template<class K, class V>
+struct MemTable {
+    shared_mutex lock;
+    SkipList<K, V> list;
+    /* Coalesced; Every Entry Still in list Is Newer than These */
+    vector<RangeTombstone<K> > ranges;
+
+    /* 1 If Found, 0 If Deleted, -1 If Older Data Must Tell */
+    int find(const K &key, V *value) {
+        Entry<K, V> *e = list.find(key);
+        if (e) {
+            if (e->isDeletion()) { return 0; }
+            *value = e->value;
+            return 1;
+        }
+        return rangesCover(ranges, key) ? 0 : -1;
+    }
+};
+
+/* What a Reader Pins: MemTables and Files It Names Stay Alive Until It Lets Go. Never Changed Once Installed */
+template<class K, class V>
+struct Version {
+    /* Taking Writes */
+    shared_ptr<MemTable<K, V> > mem;
+    /* Being Flushed; No Longer Written, so Read Without Locking; Null Between Flushes */
+    shared_ptr<MemTable<K, V> > imm;
+    shared_ptr<const IndicesTab<K> > files;
+};
+
+struct Options {
+    /* Bytes of Hot Values Kept in Front of the Disk Read Path; 0 Disables the Row Cache */
+    size_t rowCacheBytes = 0;
+    /* Async Reads Go Through io_uring When Possible, Else a Pool of This Many pread Threads */
+    bool useIoUring = true;
+    uint32_t asyncReadThreads = 4;
+    /* Upper Bound on Key-Range Pieces One Compaction Is Split into, Each Merged on Its Own Thread */
+    uint32_t subcompactions = max(1u, thread::hardware_concurrency());
+    /* Threads Reading SST Headers at Open */
+    uint32_t openThreads = 8;
+    /* Flush Once the Active MemTable Holds This Much Memory, Node Overhead Included; Below 4 GB */
+    size_t memTableBytes = 16 << 20;
+    /* Level 0 Is Compacted in the Background from NUM_PER_LEVEL Files; Writers Are Metered from
+     * level0SlowdownTrigger Files and Held at level0StopTrigger */
+    uint32_t level0SlowdownTrigger = 8;
+    uint32_t level0StopTrigger = 12;
+    /* The Same for Bytes Owed to Compaction: Level 0 and the Level 1 Files It Overlaps */
+    uint64_t softPendingCompactionBytes = 64 << 20;
+    uint64_t hardPendingCompactionBytes = 256 << 20;
+    /* Bytes per Second Writers Get at the First Slowdown Mark, Falling Linearly to Nothing at a Stop Mark */
+    uint64_t delayedWriteRate = 16 << 20;
+};
+
 template<class K, class V>
 class LSM {
 private:
     string Dir;
-    SkipList<K, V> memTab;
-    IndicesTab<K> indices;
+    Options opt;
+    Statistics stats;
+    /* Held by put(), remove(), removeRange(), ingestFiles() and reset(), so Writes and Flushes Run One at a Time;
+     * Readers Never Take It */
+    mutex writeLock;
+    /* Held Across a Whole Compaction or Ingestion, the Only Edits Below Level 0 */
+    mutex compactLock;
+    /* Serializes edit(), Manifest Write Included; Readers Never Take It */
+    mutex editLock;
+    /* Only Read and Replaced Through atomic_load() and atomic_store() */
+    shared_ptr<const Version<K, V> > current;
+    atomic<uint64_t> nextFileNumber;
+    WriteController writeController;
+    /* Guards compactionScheduled and closing; compactionDone Fires When the Background Compaction Goes Idle */
+    mutex backgroundLock;
+    condition_variable compactionDone;
+    bool compactionScheduled;
+    bool closing;
+    unique_ptr<RowCache<K, V> > rowCache;
+    once_flag readEngineOnce;
+    unique_ptr<ReadEngine> readEngine;
+    unique_ptr<ThreadPool> compactionPool;
+    /* Flushes Run One at a Time, so They Share One Write Buffer */
+    TableBuilder<K, V> tableBuilder;
+    /* Level 0 Compactions; Declared Last, so Its Thread Is Joined First */
+    unique_ptr<ThreadPool> backgroundPool;
 
-    SST<K, V> readSST(const string &filename) {
+    SST<K, V> readSST(const string &filename, uint32_t level) {
         ifstream in(filename); assert(in);
         char prefixBuf[8];
         in.read(prefixBuf, 8);
         in.seekg(0, ios::beg);
-        char *bin = new char[*(uint32_t *)prefixBuf];
-        in.read(bin, *(uint32_t *)prefixBuf);
+        unique_ptr<char[]> bin(new char[loadAs<uint32_t>(prefixBuf)]);
+        in.read(bin.get(), loadAs<uint32_t>(prefixBuf));
         in.close();
-        return SST<K, V>(bin);
+        stats.addRead(level, loadAs<uint32_t>(prefixBuf));
+        return SST<K, V>(bin.get());
     }
 
-    /* Find and Get Bounds of SSTs Intersected */
-    void findIntersectSST(vector<SST<K, V> > &merge, vector<Indices<K> > &curL,
-                          uint32_t bmin, uint32_t bmax, uint32_t levelN) {
-        vector<int> toBeDeleted;
-        for (auto i = curL.begin(); i != curL.end(); ++i) {
-            int inLevel = i - curL.begin();
-            string filename = GENERATE_FILENAME(Dir, levelN, inLevel);
-            SST<K, V> tmp = readSST(filename);
-            if (tmp.getHighBound() < bmin || tmp.getLowBound() > bmax) { continue; }
-            merge.push_back(tmp);
-            std::filesystem::remove(filename);
-            toBeDeleted.push_back(inLevel);
-        }
-        vector<int> toBeMoved(curL.size());
-        int cnt = 0;
-        for (int i = 0; i < curL.size(); ++i) {
-            if (binary_search(toBeDeleted.begin(), toBeDeleted.end(), i)) { toBeMoved[i] = -1; ++cnt; continue; }
-            toBeMoved[i] = cnt;
-        }
-        for (int i = 0; i < curL.size(); ++i) {
-            if (toBeMoved[i] > 0) {
-                rename(GENERATE_FILENAME(Dir, levelN, i), GENERATE_FILENAME(Dir, levelN, i - toBeMoved[i]));
-            }
+    /* Write a Whole SST to Disk, Accounting the Bytes to Its Level; One builder per Thread */
+    void writeSST(const string &filename, SST<K, V> &sst, uint32_t level, TableBuilder<K, V> &builder) {
+        bool ok = sst.write(filename, builder); assert(ok);
+        stats.addWritten(level, sst.getSize());
+    }
+
+    /* Write the Outputs of One Level, in Parallel When a Compaction Pool Exists, One Builder per Task */
+    void writeSSTs(const vector<pair<string, SST<K, V> *> > &outputs, uint32_t level) {
+        if (!compactionPool || outputs.size() < 2) {
+            TableBuilder<K, V> builder;
+            for (auto &o : outputs) { writeSST(o.first, *o.second, level, builder); }
+            return;
         }
-        vector<Indices<K> > newL;
-        for (auto i = curL.begin(); i != curL.end(); ++i) {
-            if (!binary_search(toBeDeleted.begin(), toBeDeleted.end(), i - curL.begin())) {
-                newL.push_back(*i);
-            }
+        size_t tasks = min<size_t>(outputs.size(), opt.subcompactions);
+        vector<future<void> > done;
+        for (size_t t = 0; t < tasks; ++t) {
+            done.push_back(compactionPool->submit([this, &outputs, t, tasks, level]() {
+                TableBuilder<K, V> builder;
+                for (size_t i = t; i < outputs.size(); i += tasks) { writeSST(outputs[i].first, *outputs[i].second, level, builder); }
+            }));
+        }
+        for (auto &d : done) { d.get(); }
+    }
+
+    /* Pin the Current Version; Everything It Names Outlives the Returned Pointer */
+    shared_ptr<const Version<K, V> > acquire() {
+        return atomic_load(&current);
+    }
+
+    /* Build the Next Version from the Current One, One Edit at a Time; the Old One Is Released Last, Deleting Files Only It Held */
+    template<class F>
+    void edit(F f) {
+        shared_ptr<const Version<K, V> > old;
+        {
+            lock_guard<mutex> g(editLock);
+            old = atomic_load(&current);
+            shared_ptr<Version<K, V> > v = make_shared<Version<K, V> >(*old);
+            f(*v);
+            /* On Disk Before the Old Version Can Go, so a Crash Never Revives Files It Alone Held */
+            if (v->files != old->files) { bool ok = v->files->saveManifest(Dir); assert(ok); }
+            atomic_store(&current, shared_ptr<const Version<K, V> >(v));
+        }
+    }
+
+    /* Write SSTs as New Files of a Level, Then Add Them to It Together, Once Every One Is on Disk */
+    void addFiles(vector<shared_ptr<FileMeta<K> > > &level, uint32_t levelN, const vector<SST<K, V> *> &ssts) {
+        vector<pair<string, SST<K, V> *> > outputs;
+        vector<uint64_t> numbers;
+        for (auto sst : ssts) {
+            numbers.push_back(nextFileNumber++);
+            outputs.push_back(make_pair(GENERATE_FILENAME(Dir, levelN, numbers.back()), sst));
+        }
+        writeSSTs(outputs, levelN);
+        for (size_t i = 0; i < ssts.size(); ++i) { level.push_back(make_shared<FileMeta<K> >(outputs[i].first, numbers[i], ssts[i]->toIndices())); }
+    }
+
+    /* No Level Below levelN Holds Keys Within the Inputs' Bounds, so Their Tombstones Have Nothing Left to Shadow */
+    static bool nothingBelow(vector<SST<K, V> > &merge, const IndicesTab<K> &files, uint32_t levelN) {
+        bool any = false;
+        K low = K(), high = K();
+        for (auto &sst : merge) {
+            if (sst.vecData().empty() && sst.vecRanges().empty()) { continue; }
+            low = any ? min(low, sst.getLowBound()) : sst.getLowBound();
+            high = any ? max(high, sst.getHighBound()) : sst.getHighBound();
+            any = true;
+        }
+        if (!any) { return true; }
+        for (uint32_t l = levelN + 1; l < files.getHeight(); ++l) {
+            if (levelOverlaps(*files.rLevel(l), low, high)) { return false; }
+        }
+        return true;
+    }
+
+    /* Find and Get Bounds of SSTs Intersected */
+    void findIntersectSST(vector<SST<K, V> > &merge, vector<shared_ptr<FileMeta<K> > > &curL,
+                          K bmin, K bmax, uint32_t levelN, const IndicesTab<K> &files) {
+        /* Range Tombstones Coming Down Are Newer than Anything in This Level */
+        vector<RangeTombstone<K> > newer;
+        for (auto &m : merge) { newer.insert(newer.end(), m.vecRanges().begin(), m.vecRanges().end()); }
+        coalesceRanges(newer);
+
+        vector<shared_ptr<FileMeta<K> > > newL;
+        for (auto &f : curL) {
+            const Indices<K> &idx = f->idx;
+            if (idx.getHighBound() < bmin || idx.getLowBound() > bmax) { newL.push_back(f); continue; }
+            /* Wholly Deleted Files Are Dropped Without Being Read */
+            if (!rangesCoverAll(newer, idx.getLowBound(), idx.getHighBound())) { merge.push_back(readSST(f->filename, levelN)); }
+            /* Readers Pinning an Older Version Keep It on Disk */
+            f->obsolete = true;
         }
         curL = newL;
-        merge = mergeSort(merge);
+        /* Nothing Older Lies Below, So Tombstones Have Done Their Job */
+        merge = mergeSort(merge, nothingBelow(merge, files, levelN));
     }
 
-    /* Newer SSTs Should Be Place Ahead 
-     * In Level 0, eg. 03 is Newer than 02 Newer than 01 
-     * Level 1 is Newer than Level 2 Newer than ... */
-    vector<SST<K, V> > mergeSort(vector<SST<K, V> > &vec) {
+    /* A Sorted Slice of One Input SST, with Its Range Tombstones Clipped to the Same Key Range */
+    struct Run {
+        typename vector<Entry<K, V> >::const_iterator begin, end;
+        vector<RangeTombstone<K> > ranges;
+    };
+
+    /* Runs Are Ordered Newest First; See mergeSort */
+    static vector<SST<K, V> > mergeRuns(const vector<Run> &runs, bool dropTombstones) {
         /* Merge */
         vector<Entry<K , V> > aftMerge[2];
-        aftMerge[0] = vec.front().vecData();
-        for (auto i = vec.begin() + 1; i != vec.end(); ++i) {
-            vector<Entry<K , V> > &to = aftMerge[(i - vec.begin()) % 2],
-                                  &from = aftMerge[(i - vec.begin() + 1) % 2],
-                                  &cur = i->vecData();
+        vector<RangeTombstone<K> > ranges = runs.front().ranges;
+        aftMerge[0].assign(runs.front().begin, runs.front().end);
+        for (size_t r = 1; r < runs.size(); ++r) {
+            vector<Entry<K , V> > &to = aftMerge[r % 2], &from = aftMerge[(r + 1) % 2], live;
+            auto pc = runs[r].begin, pcEnd = runs[r].end;
+            if (!ranges.empty()) {
+                coalesceRanges(ranges);
+                for (auto i = pc; i != pcEnd; ++i) { if (!rangesCover(ranges, i->key)) { live.push_back(*i); } }
+                pc = live.begin(); pcEnd = live.end();
+            }
+            ranges.insert(ranges.end(), runs[r].ranges.begin(), runs[r].ranges.end());
             to.clear();
-            auto pa = from.begin(), pc = cur.begin();
-            while (pa != from.end() && pc != cur.end()) {
+            auto pa = from.begin();
+            while (pa != from.end() && pc != pcEnd) {
                 if (pa->key == pc->key) {
-                    while (pc != cur.end() && pc->key == pa->key) { ++pc; }
+                    while (pc != pcEnd && pc->key == pa->key) { ++pc; }
                     to.push_back(*(pa++));
                 }
                 else { to.push_back(pa->key < pc->key ? *(pa++) : *(pc++)); }
             }
             if (pa == from.end()) {
-                for (; pc != cur.end(); ++pc) { to.push_back(*pc); }
+                for (; pc != pcEnd; ++pc) { to.push_back(*pc); }
             }
             else {
                 for (; pa != from.end(); ++pa) { to.push_back(*pa); }
             }
         }
-        vector<Entry<K, V> > &final = aftMerge[(vec.size() + 1) % 2];
+        vector<Entry<K, V> > &final = aftMerge[(runs.size() + 1) % 2];
+        if (dropTombstones) {
+            final.erase(remove_if(final.begin(), final.end(), [](const Entry<K, V> &e) { return e.isDeletion(); }), final.end());
+            ranges.clear();
+        }
+        coalesceRanges(ranges);
 
         /* Division into SSTs */
         vector<SST<K, V> > ret;
-        uint32_t curSize = 8;
-        for (auto i = final.begin(); i != final.end(); curSize = 8) {
+        uint32_t curSize = SST_HEADER_BYTES(K);
+        for (auto i = final.begin(); i != final.end(); curSize = SST_HEADER_BYTES(K)) {
             auto start = i;
+            uint32_t dataBytes = 0;
             #ifdef STRING
-            while(i != final.end() && curSize < MEM_MAX_BYTES) { curSize += sizeof(K) + 8 + i->value.size(); ++i; }
+            while(i != final.end() && curSize + FILTER_BYTES(i - start) < MEM_MAX_BYTES) { curSize += INDEX_ENTRY_BYTES(K) + i->value.size(); dataBytes += i->value.size(); ++i; }
             #endif
-            vector<Entry<K, V> > tmp; tmp.assign(start, i);
-            ret.push_back(SST<K, V>(tmp, curSize));
+            /* Clip Ranges to [First Key, Next SST's First Key), the First and Last SST Unbounded Outside */
+            vector<RangeTombstone<K> > clipped;
+            for (auto &r : ranges) {
+                K b = start == final.begin() ? r.begin : max(r.begin, start->key);
+                K e = i == final.end() ? r.end : min(r.end, i->key);
+                if (b < e) { clipped.push_back(RangeTombstone<K>(b, e)); }
+            }
+            ret.push_back(SST<K, V>(vector<Entry<K, V> >(start, i), dataBytes, clipped));
         }
+        /* Nothing but Range Tombstones */
+        if (final.empty() && !ranges.empty()) { ret.push_back(SST<K, V>(vector<Entry<K, V> >(), 0, ranges)); }
 
         return ret;
     }
 
-    /* Do Compaction */
-    void compact(SST<K, V> &sst) {
-        vector<SST<K, V> > merge;
-        vector<Indices<K> > *curL = indices.rLevel(0), *nextL;
+    /* Split Points for Subcompactions: Quantiles of Keys Sampled from Every Input at a Fixed Stride,
+     * the Stride Standing in for Block Fence Keys; Empty When the Merge Is Too Small to Split */
+    vector<K> subcompactionBounds(vector<SST<K, V> > &vec) {
+        vector<K> fences, bounds;
+        uint64_t total = 0;
+        for (auto &sst : vec) { total += sst.getSize(); }
+        if (!compactionPool || total < 2 * SUBCOMPACTION_MIN_BYTES) { return bounds; }
+        for (auto &sst : vec) {
+            vector<Entry<K, V> > &data = sst.vecData();
+            for (size_t i = 0; i < data.size(); i += SUBCOMPACTION_FENCE_STRIDE) { fences.push_back(data[i].key); }
+        }
+        sort(fences.begin(), fences.end());
+        uint32_t n = min<uint64_t>(opt.subcompactions, total / SUBCOMPACTION_MIN_BYTES);
+        for (uint32_t j = 1; j < n; ++j) {
+            K b = fences[fences.size() * j / n];
+            if (bounds.empty() ? b > fences.front() : b > bounds.back()) { bounds.push_back(b); }
+        }
+        return bounds;
+    }
+
+    /* Newer SSTs Should Be Place Ahead 
+     * In Level 0, eg. 03 is Newer than 02 Newer than 01 
+     * Level 1 is Newer than Level 2 Newer than ... 
+     * With dropTombstones, Deletions Are Discarded Along with the Values They Shadow 
+     * Range Tombstones Drop Entries of Older SSTs; Entries of Their Own SST Are Newer 
+     * Large Merges Are Cut into Disjoint Key Ranges Merged in Parallel, Outputs Concatenated in Order */
+    vector<SST<K, V> > mergeSort(vector<SST<K, V> > &vec, bool dropTombstones = false) {
+        vector<K> bounds = subcompactionBounds(vec);
+        vector<future<vector<SST<K, V> > > > parts;
+        for (size_t j = 0; j <= bounds.size(); ++j) {
+            bool first = j == 0, last = j == bounds.size();
+            vector<Run> runs;
+            for (auto &sst : vec) {
+                const vector<Entry<K, V> > &data = sst.vecData();
+                Run run;
+                run.begin = first ? data.begin() : lower_bound(data.begin(), data.end(), bounds[j - 1],
+                                                               [](const Entry<K, V> &e, const K &k) { return e.key < k; });
+                run.end = last ? data.end() : lower_bound(data.begin(), data.end(), bounds[j],
+                                                          [](const Entry<K, V> &e, const K &k) { return e.key < k; });
+                for (auto &r : sst.vecRanges()) {
+                    K b = first ? r.begin : max(r.begin, bounds[j - 1]);
+                    K e = last ? r.end : min(r.end, bounds[j]);
+                    if (b < e) { run.ranges.push_back(RangeTombstone<K>(b, e)); }
+                }
+                runs.push_back(run);
+            }
+            if (bounds.empty()) { return mergeRuns(runs, dropTombstones); }
+            parts.push_back(compactionPool->submit([runs, dropTombstones]() { return mergeRuns(runs, dropTombstones); }));
+        }
+        stats.subcompactions.fetch_add(parts.size(), memory_order_relaxed);
+
+        vector<SST<K, V> > ret;
+        for (auto &p : parts) {
+            vector<SST<K, V> > part = p.get();
+            for (auto &sst : part) { ret.push_back(move(sst)); }
+        }
+        return ret;
+    }
+
+    /* Do Compaction on files, the Writer's Copy of the Levels; merge Holds the Incoming SSTs,
+     * Newer than Level 0 and Disjoint from Each Other */
+    void compact(vector<SST<K, V> > &merge, IndicesTab<K> &files) {
+        StopWatch watch(&stats.latency[OP_COMPACT]);
+        vector<shared_ptr<FileMeta<K> > > *curL = files.rLevel(0), *nextL;
         uint32_t nNextL;
 
-        merge.push_back(sst);
         for (auto i = curL->rbegin(); i != curL->rend(); ++i) {
-            string curFilename = GENERATE_FILENAME(Dir, 0, curL->size() - 1 - (i - curL->rbegin()));
-            SST<K, V> tmp = readSST(curFilename);
-            merge.push_back(tmp);
-            std::filesystem::remove(path(curFilename));
+            merge.push_back(readSST((*i)->filename, 0));
+            (*i)->obsolete = true;
         }
         curL->clear();
-        merge = mergeSort(merge);
-        uint32_t bmin = merge.front().getLowBound();
-        uint32_t bmax = merge.back().getHighBound();
+        merge = mergeSort(merge, nothingBelow(merge, files, 0));
+        /* Everything Cancelled Out */
+        if (merge.empty()) { return; }
+        K bmin = merge.front().getLowBound();
+        K bmax = merge.back().getHighBound();
 
         /* No Level 1 */
-        if (indices.getHeight() < 2) { 
-            indices.addNewLevel();
-            nextL = indices.rLevel(nNextL = 1);
-            for (auto i = merge.begin(); i != merge.end(); ++i) {
-                nextL->push_back(Indices<K>(i->toIndexBin(), i->getSize(), i->getDataSegBias()));
-                ofstream out(GENERATE_FILENAME(Dir, nNextL, i - merge.begin()));
-                out.write(i->toBin().bin, i->toBin().length);
-                out.close();
-            }
+        if (files.getHeight() < 2) { 
+            files.addNewLevel();
+            nextL = files.rLevel(nNextL = 1);
+            vector<SST<K, V> *> outputs;
+            for (auto &m : merge) { outputs.push_back(&m); }
+            addFiles(*nextL, nNextL, outputs);
             return;
         }
         
         
-        nextL = indices.rLevel(nNextL = 1);
+        nextL = files.rLevel(nNextL = 1);
         while (true) {
-            findIntersectSST(merge, *nextL, bmin, bmax, nNextL);
+            findIntersectSST(merge, *nextL, bmin, bmax, nNextL, files);
             uint32_t remAvail = MAX_SST_NUM(nNextL) - nextL->size();
             int toNextL = merge.size() - remAvail;
 
             /* If Space Remained, Fill Them */
             if (remAvail) {
                 int n = merge.size() < remAvail ? merge.size() : remAvail; 
-                for (int i = 0; i < n; ++i) {
-                    auto ite = merge.rbegin();
-                    ofstream out(GENERATE_FILENAME(Dir, nNextL, nextL->size()));
-                    out.write(ite->toBin().bin, ite->toBin().length);
-                    out.close();
-                    nextL->push_back(Indices<K>(ite->toIndexBin(), ite->getSize(), ite->getDataSegBias()));
-                    merge.pop_back();
-                }
+                vector<SST<K, V> *> outputs;
+                for (int i = 0; i < n; ++i) { outputs.push_back(&merge[merge.size() - 1 - i]); }
+                addFiles(*nextL, nNextL, outputs);
+                merge.erase(merge.end() - n, merge.end());
             }
 
             /* If SSTs Overflow the Level */
             if (toNextL > 0) {
                 /* Next Level Exists */
-                if (indices.getHeight() > nNextL + 1) {
-                    nextL = indices.rLevel(++nNextL);
+                if (files.getHeight() > nNextL + 1) {
+                    nextL = files.rLevel(++nNextL);
                     bmin =  merge.front().getLowBound();
                     bmax = merge.back().getHighBound();
                 }
                 /* Does Not Exist */
                 else {
-                    indices.addNewLevel();
-                    nextL = indices.rLevel(++nNextL);
-                    for (auto i = merge.rbegin(); i - merge.rbegin() < toNextL; ++i) {
-                        nextL->push_back(Indices<K>(i->toIndexBin(), i->getSize(), i->getDataSegBias()));
-                        ofstream out(GENERATE_FILENAME(Dir, nNextL, i - merge.rbegin()));
-                        out.write(i->toBin().bin, i->toBin().length);
-                        out.close();
-                    }
+                    files.addNewLevel();
+                    nextL = files.rLevel(++nNextL);
+                    vector<SST<K, V> *> outputs;
+                    for (auto i = merge.rbegin(); i - merge.rbegin() < toNextL; ++i) { outputs.push_back(&*i); }
+                    addFiles(*nextL, nNextL, outputs);
                     break;
                 }
             }
@@ -444,29 +1076,131 @@ private:
         }
     }
 
-    /* If Compact, Return false; If Not, Return True. */
-    bool dump(SST<K, V> &sst) {
-        Bin b = sst.toIndexBin();
-        string filename;
-        bool doNotCompact = indices.insert(Indices<K>(b, sst.getSize(), sst.getDataSegBias()), filename);
-        if (doNotCompact) {
-            ofstream out(filename);  assert(out);
-            b = sst.toBin();
-            out.write(b.bin, b.length);
-            out.close();
-            return true;
+    /* Whether Any File of a Level Shares Keys with [low, high] */
+    static bool levelOverlaps(const vector<shared_ptr<FileMeta<K> > > &level, const K &low, const K &high) {
+        for (auto &f : level) {
+            if (!(f->idx.getHighBound() < low || high < f->idx.getLowBound())) { return true; }
+        }
+        return false;
+    }
+
+    /* Whether the MemTable or Its Range Tombstones Touch [low, high]; Writer Only */
+    bool memOverlaps(const K &low, const K &high) {
+        shared_ptr<const Version<K, V> > v = acquire();
+        MemTable<K, V> &mem = *v->mem;
+        if (mem.list.intersects(low, high)) { return true; }
+        for (auto &r : mem.ranges) {
+            if (!(high < r.begin) && low < r.end) { return true; }
+        }
+        return false;
+    }
+
+    /* Stream imm Straight into a New Level 0 File; Only a Compaction Copies It out */
+    shared_ptr<FileMeta<K> > dump(MemTable<K, V> &imm) {
+        StopWatch watch(&stats.latency[OP_FLUSH]);
+        uint64_t number = nextFileNumber++;
+        string filename = GENERATE_FILENAME(Dir, 0, number);
+        Indices<K> idx;
+        bool ok = tableBuilder.build(filename, imm.list.size(), imm.list.dataSize(), imm.ranges,
+                                     [&imm](auto f) { imm.list.scan(f); }, &idx);
+        assert(ok);
+        stats.addWritten(0, idx.getSize());
+        return make_shared<FileMeta<K> >(filename, number, idx);
+    }
+
+    /* Bytes Compaction Must Rewrite to Empty Level 0: Its Files and the Level 1 Files They Overlap */
+    static uint64_t pendingCompactionBytes(const IndicesTab<K> &files) {
+        const vector<shared_ptr<FileMeta<K> > > &l0 = *files.rLevel(0);
+        if (l0.empty()) { return 0; }
+        uint64_t ret = 0;
+        K low = l0.front()->idx.getLowBound(), high = l0.front()->idx.getHighBound();
+        for (auto &f : l0) {
+            ret += f->idx.getSize();
+            low = min(low, f->idx.getLowBound());
+            high = max(high, f->idx.getHighBound());
+        }
+        if (files.getHeight() > 1) {
+            for (auto &f : *files.rLevel(1)) {
+                if (!(f->idx.getHighBound() < low || high < f->idx.getLowBound())) { ret += f->idx.getSize(); }
+            }
+        }
+        return ret;
+    }
+
+    /* Level 0 Has Reached Its Trigger, or Owes More than the Soft Limit */
+    bool compactionDue(const IndicesTab<K> &files) {
+        uint32_t l0 = files.rLevel(0)->size();
+        return l0 >= NUM_PER_LEVEL || (l0 && pendingCompactionBytes(files) > opt.softPendingCompactionBytes);
+    }
+
+    /* 0 Short of Both Slowdown Marks, Rising to 1 at Whichever Stop Mark Comes First */
+    double writePressure(const IndicesTab<K> &files) {
+        double p = 0;
+        uint32_t l0 = files.rLevel(0)->size();
+        if (l0 >= opt.level0SlowdownTrigger) {
+            p = double(l0 - opt.level0SlowdownTrigger + 1) / (opt.level0StopTrigger - opt.level0SlowdownTrigger + 1);
+        }
+        uint64_t pending = pendingCompactionBytes(files);
+        if (pending > opt.softPendingCompactionBytes) {
+            p = max(p, double(pending - opt.softPendingCompactionBytes) / (opt.hardPendingCompactionBytes - opt.softPendingCompactionBytes));
+        }
+        return p;
+    }
+
+    /* Queue a Compaction If One Is Due and None Is Queued, Then Re-Pace Writers; Called After Every Edit of
+     * Level 0, so the Pressure Set Last Always Comes from the Newest Version */
+    void scheduleCompaction() {
+        lock_guard<mutex> g(backgroundLock);
+        shared_ptr<const Version<K, V> > v = acquire();
+        if (!compactionScheduled && !closing && compactionDue(*v->files)) {
+            compactionScheduled = true;
+            backgroundPool->post([this]() { backgroundCompaction(); });
         }
-        else { compact(sst); return false; }
+        writeController.update(writePressure(*v->files));
     }
 
-    bool getFromDisk(const K &key, V *value = nullptr) {
+    /* Runs on backgroundPool Until No Compaction Is Due. Writers Are Only Ever Held While One Is */
+    void backgroundCompaction() {
+        while (true) {
+            {
+                lock_guard<mutex> g(backgroundLock);
+                shared_ptr<const Version<K, V> > v = acquire();
+                writeController.update(writePressure(*v->files));
+                if (closing || !compactionDue(*v->files)) {
+                    compactionScheduled = false;
+                    compactionDone.notify_all();
+                    return;
+                }
+            }
+            compactLevel0();
+        }
+    }
+
+    /* Merge the Level 0 Files Present at the Start Down; Those Flushed Meanwhile Stay, Newer than All of Them */
+    void compactLevel0() {
+        lock_guard<mutex> g(compactLock);
+        IndicesTab<K> files(*acquire()->files);
+        if (!compactionDue(files)) { return; }
+        vector<shared_ptr<FileMeta<K> > > picked = *files.rLevel(0);
+        vector<SST<K, V> > merge;
+        compact(merge, files);
+        edit([&](Version<K, V> &v) {
+            for (auto &f : *v.files->rLevel(0)) {
+                if (find(picked.begin(), picked.end(), f) == picked.end()) { files.rLevel(0)->push_back(f); }
+            }
+            v.files = make_shared<IndicesTab<K> >(move(files));
+        });
+    }
+
+    bool getFromDisk(const Version<K, V> &v, const K &key, V *value = nullptr) {
         string filename;
-        uint32_t dataSegBias, bias, length;
-        bool found = indices.find(key, &filename, &dataSegBias, &bias, &length);
+        uint32_t dataSegBias, bias, length, level;
+        bool found = v.files->find(key, &filename, &dataSegBias, &bias, &length, &level);
         if (found) {
+            stats.addRead(level, length);
             ifstream in(filename);
             in.seekg(dataSegBias + bias);
-            char valueBuff[length];
+            char valueBuff[length + 1];
             in.read(valueBuff, length);
             in.close();
             #ifdef STRING
@@ -476,69 +1210,409 @@ private:
         }
         else { return false; }
     }
+
+    /* MemTables, Their Range Tombstones and the Row Cache; 1 If Found, 0 If Deleted, -1 If the Disk Must Tell */
+    int getFromMemory(const Version<K, V> &v, const K &key, V *value) {
+        int ret;
+        {
+            shared_lock<shared_mutex> g(v.mem->lock);
+            ret = v.mem->find(key, value);
+        }
+        if (ret < 0 && v.imm) { ret = v.imm->find(key, value); }
+        if (ret >= 0) {
+            stats.memTabHits.fetch_add(1, memory_order_relaxed);
+            return ret;
+        }
+        stats.memTabMisses.fetch_add(1, memory_order_relaxed);
+        if (rowCache && rowCache->get(key, value)) { return 1; }
+        return -1;
+    }
+
+    /* Locate the Value and Open Its File, Leaving Only the Read Itself; false If It Is Not on Disk */
+    bool prepareRead(const Version<K, V> &v, const K &key, ReadRequest *req) {
+        string filename;
+        uint32_t dataSegBias, bias, length, level;
+        if (!v.files->find(key, &filename, &dataSegBias, &bias, &length, &level)) { return false; }
+        /* An Open Descriptor Survives the File Being Deleted Before the Read Lands */
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) { return false; }
+        stats.addRead(level, length);
+        req->fd = fd;
+        req->offset = dataSegBias + bias;
+        req->length = length;
+        req->buf = new char[length + 1];
+        return true;
+    }
+
+    ReadEngine *engine() {
+        call_once(readEngineOnce, [this]() { readEngine = makeReadEngine(opt.useIoUring, opt.asyncReadThreads); });
+        return readEngine.get();
+    }
+
+    /* Readers Keep Seeing the Old MemTable as imm While It Is Written out; Writer Only */
+    void flush() {
+        shared_ptr<MemTable<K, V> > imm = acquire()->mem;
+        edit([](Version<K, V> &v) {
+            v.imm = v.mem;
+            v.mem = make_shared<MemTable<K, V> >();
+        });
+        shared_ptr<FileMeta<K> > f = dump(*imm);
+        edit([&f](Version<K, V> &v) {
+            shared_ptr<IndicesTab<K> > files = make_shared<IndicesTab<K> >(*v.files);
+            files->rLevel(0)->push_back(f);
+            v.files = files;
+            v.imm = nullptr;
+        });
+        scheduleCompaction();
+    }
+
+    void flushIfFull() {
+        shared_ptr<const Version<K, V> > v = acquire();
+        MemTable<K, V> &mem = *v->mem;
+        if (mem.list.memoryUsage() + mem.ranges.size() * sizeof(RangeTombstone<K>) >= opt.memTableBytes) { flush(); }
+    }
+
+    /* Shared by put() and remove() */
+    void write(const K &key, const V &val, EntryType type) {
+        shared_ptr<const Version<K, V> > v = acquire();
+        MemTable<K, V> &mem = *v->mem;
+        {
+            unique_lock<shared_mutex> g(mem.lock);
+            mem.list.put(key, val, type);
+        }
+        /* After the Insert: a Reader Missing It Took Its Cache Version Earlier, so Cannot Cache the Old Value */
+        if (rowCache) { rowCache->erase(key); }
+        flushIfFull();
+    }
 public:
-    explicit LSM(const string &dir): Dir(dir), indices(dir) { 
-        path _dir(dir);
-        if (!exists(_dir)) { assert(create_directory(_dir)); }
+    /* get() and the Async Reads May Run on Any Number of Threads, Alongside Any One Writer Call at a Time */
+    explicit LSM(const string &dir, const Options &_opt = Options())
+        : Dir(dir), opt(_opt), writeController(_opt.delayedWriteRate, &stats), compactionScheduled(false), closing(false) { 
+        /* Writers Must Never Be Held Without a Compaction Due to Free Them */
+        opt.level0SlowdownTrigger = max<uint32_t>(opt.level0SlowdownTrigger, NUM_PER_LEVEL);
+        opt.level0StopTrigger = max(opt.level0StopTrigger, opt.level0SlowdownTrigger);
+        opt.hardPendingCompactionBytes = max(opt.hardPendingCompactionBytes, opt.softPendingCompactionBytes + 1);
+        if (opt.rowCacheBytes) { rowCache.reset(new RowCache<K, V>(opt.rowCacheBytes, &stats)); }
+        if (opt.subcompactions > 1) { compactionPool.reset(new ThreadPool(opt.subcompactions)); }
+        backgroundPool.reset(new ThreadPool(1));
+        shared_ptr<Version<K, V> > v = make_shared<Version<K, V> >();
+        v->mem = make_shared<MemTable<K, V> >();
+        shared_ptr<IndicesTab<K> > files = make_shared<IndicesTab<K> >(dir, &stats, opt.openThreads);
+        nextFileNumber = files->maxFileNumber() + 1;
+        bool ok = files->saveManifest(dir); assert(ok);
+        v->files = files;
+        atomic_store(&current, shared_ptr<const Version<K, V> >(v));
+        scheduleCompaction();
     }
 
+    /* A Running Compaction Finishes First; Level 0 Files Still Due Are Compacted After the Next Open */
     ~LSM() {
-        if (memTab.size()) {
-            SST<K, V> sst(memTab.data(), memTab.dataSize());
-            dump(sst);
+        {
+            lock_guard<mutex> g(writeLock);
+            shared_ptr<const Version<K, V> > v = acquire();
+            if (v->mem->list.size() || !v->mem->ranges.empty()) { flush(); }
         }
+        unique_lock<mutex> g(backgroundLock);
+        closing = true;
+        compactionDone.wait(g, [this]() { return !compactionScheduled; });
     }
 
-    /* If Compact, Return false; If Not, Return True. */
+    /* true once the Entry Is Stored; Write Controller Stalls Show in Statistics */
     bool put(const K &key, const V &val) {
-        if (memTab.put(key, val) + 8 + memTab.size() * (sizeof(K) + 8) >= MEM_MAX_BYTES) {
-            SST<K, V> sst(memTab.data(), memTab.dataSize());
-            if (!dump(sst)) { return false; }
-            memTab.reset();
+        StopWatch watch(&stats.latency[OP_PUT]);
+        uint64_t bytes = sizeof(K);
+        #ifdef STRING
+        bytes += val.size();
+        #endif
+        stats.userBytesWritten.fetch_add(bytes, memory_order_relaxed);
+        writeController.admit(bytes);
+        lock_guard<mutex> g(writeLock);
+        write(key, val, ENTRY_VALUE);
+        return true;
+    }
+
+    /* Return Whether the Key Exists; Empty Values Are Legal and Distinct from Absent Keys */
+    bool get(const K &key, V *value) {
+        StopWatch watch(&stats.latency[OP_GET]);
+        /* Before Pinning: Any Write the Version Misses Bumps the Cache Version Afterwards */
+        uint64_t cacheVersion = rowCache ? rowCache->version(key) : 0;
+        shared_ptr<const Version<K, V> > v = acquire();
+        int inMemory = getFromMemory(*v, key, value);
+        if (inMemory >= 0) { return inMemory; }
+
+        if (getFromDisk(*v, key, value)) {
+            if (rowCache) { rowCache->insert(key, *value, cacheVersion); }
+            return true;
         }
 
-        return true;
+        return false;
     }
 
     V get(const K &key) {
-        V *memGet = memTab.get(key);
-        if (memGet) { return *memGet; }
+        V ret;
+        return get(key, &ret) ? ret : V();
+    }
 
-        V diskGet;
-        if (getFromDisk(key, &diskGet)) { return diskGet; }
+    /* Read the Cold Filters, Then Indices, the Keys Probe Through the Engine in Two Batches, Then Call then() */
+    void warmIndices(shared_ptr<const Version<K, V> > v, shared_ptr<const vector<pair<size_t, K> > > keys,
+                     function<void()> then, LazySegment s = SEGMENT_FILTER) {
+        vector<shared_ptr<FileMeta<K> > > cold;
+        for (uint32_t l = 0; l < v->files->getHeight(); ++l) {
+            for (auto &f : *v->files->rLevel(l)) {
+                if (f->idx.loaded(s)) { continue; }
+                for (auto &k : *keys) {
+                    bool probed = s == SEGMENT_FILTER ? f->idx.spans(k.second) : f->idx.loaded(SEGMENT_FILTER) && f->idx.mayContain(k.second);
+                    if (probed) { cold.push_back(f); break; }
+                }
+            }
+        }
+        function<void()> next = s == SEGMENT_FILTER ? [this, v, keys, then]() { warmIndices(v, keys, then, SEGMENT_INDEX); } : then;
+        if (cold.empty()) { next(); return; }
 
-        return V();
+        vector<ReadRequest> reqs;
+        auto left = make_shared<atomic<size_t> >(cold.size());
+        for (auto &f : cold) {
+            /* A File That Fails Here Is Loaded on First Use, as Before */
+            int fd = open(f->filename.c_str(), O_RDONLY);
+            if (fd < 0) { if (--*left == 0) { next(); } continue; }
+            uint32_t length = f->idx.segmentLength(s);
+            char *buf = new char[length + 1];
+            ReadRequest req{ fd, f->idx.segmentOffset(s), length, buf, nullptr };
+            req.done = [f, s, fd, buf, length, left, next](ssize_t n) {
+                close(fd);
+                if (n == length) { f->idx.install(s, buf); }
+                delete []buf;
+                if (--*left == 0) { next(); }
+            };
+            reqs.push_back(req);
+        }
+        if (!reqs.empty()) { engine()->submit(reqs); }
     }
 
+    /* Look up Every Key with All Disk Reads in Flight Together; callback(i, found, value) May Run Inline or on an I/O Thread */
+    void getBatchAsync(const vector<K> &keys, function<void(size_t, bool, const V &)> callback) {
+        auto cacheVersions = make_shared<vector<uint64_t> >();
+        for (auto &k : keys) { cacheVersions->push_back(rowCache ? rowCache->version(k) : 0); }
+        /* Pinned Only Until Every File Is Open */
+        shared_ptr<const Version<K, V> > pinned = acquire();
+        auto onDisk = make_shared<vector<pair<size_t, K> > >();
+        for (size_t i = 0; i < keys.size(); ++i) {
+            V v;
+            int inMemory = getFromMemory(*pinned, keys[i], &v);
+            if (inMemory >= 0) { callback(i, inMemory, v); continue; }
+            onDisk->push_back(make_pair(i, keys[i]));
+        }
+        if (onDisk->empty()) { return; }
+        warmIndices(pinned, onDisk, [this, pinned, onDisk, cacheVersions, callback]() { readBatch(*pinned, *onDisk, *cacheVersions, callback); });
+    }
+
+    /* Second Half of getBatchAsync(), Once Every Filter and Index It Probes Is Loaded */
+    void readBatch(const Version<K, V> &pinned, const vector<pair<size_t, K> > &onDisk, const vector<uint64_t> &cacheVersions,
+                   function<void(size_t, bool, const V &)> callback) {
+        vector<ReadRequest> reqs;
+        for (auto &d : onDisk) {
+            size_t i = d.first;
+            ReadRequest req;
+            uint64_t cacheVersion = cacheVersions[i];
+            if (!prepareRead(pinned, d.second, &req)) { callback(i, false, V()); continue; }
+            RowCache<K, V> *cache = rowCache.get();
+            K key = d.second;
+            int fd = req.fd; char *buf = req.buf; uint32_t length = req.length;
+            req.done = [=](ssize_t n) {
+                close(fd);
+                bool ok = n == length;
+                V value;
+                #ifdef STRING
+                if (ok) { value = V(buf, length); }
+                #endif
+                delete []buf;
+                if (ok && cache) { cache->insert(key, value, cacheVersion); }
+                callback(i, ok, value);
+            };
+            reqs.push_back(req);
+        }
+        if (!reqs.empty()) { engine()->submit(reqs); }
+    }
+
+    void getAsync(const K &key, function<void(bool, const V &)> callback) {
+        getBatchAsync(vector<K>(1, key), [callback](size_t, bool found, const V &v) { callback(found, v); });
+    }
+
+    future<pair<bool, V> > getAsync(const K &key) {
+        auto done = make_shared<promise<pair<bool, V> > >();
+        future<pair<bool, V> > ret = done->get_future();
+        getAsync(key, [done](bool found, const V &v) { done->set_value(make_pair(found, v)); });
+        return ret;
+    }
+
+    /* Blocking Batch Lookup with Every Disk Read in Flight at Once */
+    vector<pair<bool, V> > multiGet(const vector<K> &keys) {
+        vector<pair<bool, V> > ret(keys.size());
+        if (keys.empty()) { return ret; }
+        atomic<size_t> left(keys.size());
+        promise<void> all;
+        future<void> allDone = all.get_future();
+        getBatchAsync(keys, [&](size_t i, bool found, const V &v) {
+            ret[i] = make_pair(found, v);
+            if (--left == 0) { all.set_value(); }
+        });
+        allDone.wait();
+        return ret;
+    }
+
+    /* Refresh Level Shape and Return the Counters; Text via toString(), JSON via toJSON() */
+    const Statistics &getStats() {
+        shared_ptr<const Version<K, V> > v = acquire();
+        for (uint32_t l = 0; l < STATS_MAX_LEVEL; ++l) {
+            uint64_t files = 0, bytes = 0;
+            if (l < v->files->getHeight()) {
+                const vector<shared_ptr<FileMeta<K> > > *curL = v->files->rLevel(l);
+                files = curL->size();
+                for (auto &f : *curL) { bytes += f->idx.getSize(); }
+            }
+            stats.setLevelShape(l, files, bytes);
+        }
+        return stats;
+    }
+
+    void resetStats() { stats.reset(); }
+
+    /* Files Go Once Readers Still Holding the Old Version Let Go */
     void reset() {
-        memTab.reset();
-        indices.clear();
-        path p(Dir);
-        remove_all(p);
-        assert(create_directory(p));
+        lock_guard<mutex> g(writeLock);
+        lock_guard<mutex> c(compactLock);
+        shared_ptr<const Version<K, V> > old = acquire();
+        for (uint32_t l = 0; l < old->files->getHeight(); ++l) {
+            for (auto &f : *old->files->rLevel(l)) { f->obsolete = true; }
+        }
+        edit([this](Version<K, V> &v) {
+            v.mem = make_shared<MemTable<K, V> >();
+            v.imm = nullptr;
+            v.files = make_shared<IndicesTab<K> >(&stats);
+        });
+        if (rowCache) { rowCache->clear(); }
+
+        /* Wipe the Directory but the Manifest and Files a Reader Still Pins, Which Go When It Lets Go */
+        set<string> pinned;
+        if (old.use_count() > 1) {
+            for (uint32_t l = 0; l < old->files->getHeight(); ++l) {
+                for (auto &f : *old->files->rLevel(l)) { pinned.insert(path(f->filename).filename().string()); }
+            }
+        }
+        old = nullptr;
+        for (auto &entry : directory_iterator(Dir)) {
+            string name = entry.path().filename().string();
+            if (name != MANIFEST_NAME && !pinned.count(name)) { error_code ec; remove_all(entry.path(), ec); }
+        }
+        scheduleCompaction();
     }
 
     bool remove(const K &key) {
-        V *memGet = memTab.get(key);
-        if (memGet) {
-            #ifdef STRING
-            if ((*memGet).empty()) { return false; }
-            else {
-                memTab.put(key, "");
-            }
-            #endif
+        StopWatch watch(&stats.latency[OP_REMOVE]);
+        writeController.admit(sizeof(K));
+        lock_guard<mutex> g(writeLock);
+        /* Tombstones Are Written Blindly; Only One Already in the MemTable Is Skipped */
+        Entry<K, V> *memGet = acquire()->mem->list.find(key);
+        if (memGet && memGet->isDeletion()) { return false; }
+        write(key, V(), ENTRY_DELETION);
+        return true;
+    }
+
+    /* Bulk Load Disjoint SSTs from SSTWriter over Everything Stored; Copied, or Moved If moveFiles; false Ingests Nothing */
+    bool ingestFiles(const vector<string> &paths, bool moveFiles = false) {
+        lock_guard<mutex> g(writeLock);
+        lock_guard<mutex> c(compactLock);
+        vector<pair<unique_ptr<Indices<K> >, string> > files;
+        for (auto &p : paths) {
+            unique_ptr<Indices<K> > idx = loadIndices<K>(p);
+            if (!idx) { return false; }
+            files.push_back(make_pair(move(idx), p));
+        }
+        sort(files.begin(), files.end(), [](const pair<unique_ptr<Indices<K> >, string> &a, const pair<unique_ptr<Indices<K> >, string> &b) {
+            return a.first->getLowBound() < b.first->getLowBound();
+        });
+        for (size_t i = 1; i < files.size(); ++i) {
+            if (!(files[i - 1].first->getHighBound() < files[i].first->getLowBound())) { return false; }
+        }
+
+        /* The MemTable Is Newer than Anything on Disk, so If It Overlaps It Must Get There First */
+        for (auto &f : files) {
+            if (memOverlaps(f.first->getLowBound(), f.first->getHighBound())) { flush(); break; }
         }
-        else {
-            string filename;
-            uint32_t dataSegBias, bias, length;
-            bool found = indices.find(key, &filename, &dataSegBias, &bias, &length);
-            if (found) {
-                memTab.put(key, "");
+
+        IndicesTab<K> tab(*acquire()->files);
+        vector<SST<K, V> > leftover;
+        vector<shared_ptr<FileMeta<K> > > created;
+        for (auto &f : files) {
+            K low = f.first->getLowBound(), high = f.first->getHighBound();
+
+            int target = -1;
+            if (!levelOverlaps(*tab.rLevel(0), low, high)) {
+                uint32_t l = 1;
+                for (; l < tab.getHeight(); ++l) {
+                    vector<shared_ptr<FileMeta<K> > > *curL = tab.rLevel(l);
+                    if (levelOverlaps(*curL, low, high)) { break; }
+                    if (curL->size() < MAX_SST_NUM(l)) { target = l; }
+                }
+                /* Clear All the Way Down, but Every Level Full */
+                if (l == tab.getHeight() && target < 0) { tab.addNewLevel(); target = l; }
             }
-            else {
-                return false;
+            /* Blocked Right Below: Still Fine as the Newest File of Level 0 */
+            if (target < 0 && tab.rLevel(0)->size() < NUM_PER_LEVEL) { target = 0; }
+            if (target < 0) { leftover.push_back(readSST(f.second, 0)); continue; }
+
+            uint64_t number = nextFileNumber++;
+            string filename = GENERATE_FILENAME(Dir, target, number);
+            error_code ec;
+            if (moveFiles) { create_hard_link(f.second, filename, ec); }
+            if (!moveFiles || ec) {
+                ec.clear();
+                copy_file(f.second, filename, copy_options::overwrite_existing, ec);
+                if (ec) {
+                    /* Dropping tab and created Unlinks Every File Made So Far */
+                    std::filesystem::remove(filename, ec);
+                    for (auto &c : created) { c->obsolete = true; }
+                    return false;
+                }
+                stats.addWritten(target, f.first->getSize());
+            }
+            created.push_back(make_shared<FileMeta<K> >(filename, number, *f.first));
+            tab.rLevel(target)->push_back(created.back());
+        }
+
+        /* Only Now, with Nothing Left to Fail, Are Live Files Marked Obsolete */
+        if (!leftover.empty()) { compact(leftover, tab); }
+        edit([&tab](Version<K, V> &v) { v.files = make_shared<IndicesTab<K> >(move(tab)); });
+        scheduleCompaction();
+        /* Only Once Readers Can See the New Files, Else a Racing Read Could Cache What They Shadow */
+        if (rowCache) {
+            for (auto &f : files) {
+                rowCache->eraseRange(f.first->getLowBound(), f.first->getHighBound());
+                rowCache->erase(f.first->getHighBound());
             }
         }
+        if (moveFiles) {
+            for (auto &f : files) { error_code ec; std::filesystem::remove(f.second, ec); }
+        }
         return true;
     }
+
+    /* Delete Every Key in [begin, end) with a Single Range Tombstone */
+    void removeRange(const K &begin, const K &end) {
+        StopWatch watch(&stats.latency[OP_REMOVE_RANGE]);
+        if (!(begin < end)) { return; }
+        writeController.admit(RANGE_ENTRY_BYTES(K));
+        lock_guard<mutex> g(writeLock);
+        shared_ptr<const Version<K, V> > v = acquire();
+        MemTable<K, V> &mem = *v->mem;
+        {
+            unique_lock<shared_mutex> l(mem.lock);
+            /* Covered MemTable Entries Go Away Now, Keeping Every Remaining One Newer than Its Ranges */
+            mem.list.removeRange(begin, end);
+            mem.ranges.push_back(RangeTombstone<K>(begin, end));
+            coalesceRanges(mem.ranges);
+        }
+        if (rowCache) { rowCache->eraseRange(begin, end); }
+        flushIfFull();
+    }
 };
\ No newline at end of file
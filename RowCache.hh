@@ -0,0 +1,123 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <map>
+#include <functional>
+#include "Stats.hh"
+
+using namespace std;
+
+#define ROW_CACHE_SHARDS 16
+/* Per-Entry Bookkeeping: List Node, Tree Node and Key Copy, Roughly */
+#define ROW_CACHE_ENTRY_OVERHEAD 64
+
+/* Sharded, Byte-Bounded LRU Cache of Resolved Values, Keyed by User Key */
+template<class K, class V>
+class RowCache {
+private:
+    struct Shard {
+        mutex lock;
+        list<pair<K, V> > lru;  /* Front Is Most Recently Used */
+        /* Ordered, so a Range Erase Visits Only the Keys Inside It */
+        map<K, typename list<pair<K, V> >::iterator> index;
+        size_t usage = 0;
+        /* Bumped by Every Invalidation */
+        uint64_t version = 0;
+    };
+
+    Shard shards[ROW_CACHE_SHARDS];
+    size_t shardCapacity;
+    Statistics *stats;
+
+    Shard &shardOf(const K &key) { return shards[hash<K>()(key) % ROW_CACHE_SHARDS]; }
+
+    static size_t charge(const pair<K, V> &e) {
+        size_t c = ROW_CACHE_ENTRY_OVERHEAD + sizeof(K) + sizeof(V);
+        /* String Limited */
+        #ifdef STRING
+        c += e.second.size();
+        #endif
+        return c;
+    }
+
+    void eraseLocked(Shard &s, typename list<pair<K, V> >::iterator ite) {
+        s.usage -= charge(*ite);
+        s.index.erase(ite->first);
+        s.lru.erase(ite);
+    }
+
+public:
+    explicit RowCache(size_t capacity, Statistics *_stats = nullptr)
+        : shardCapacity(capacity / ROW_CACHE_SHARDS), stats(_stats) {}
+
+    bool get(const K &key, V *value) {
+        Shard &s = shardOf(key);
+        lock_guard<mutex> g(s.lock);
+        auto found = s.index.find(key);
+        if (found == s.index.end()) {
+            if (stats) { stats->rowCacheMisses.fetch_add(1, memory_order_relaxed); }
+            return false;
+        }
+        s.lru.splice(s.lru.begin(), s.lru, found->second);
+        *value = found->second->second;
+        if (stats) { stats->rowCacheHits.fetch_add(1, memory_order_relaxed); }
+        return true;
+    }
+
+    /* Taken Before a Disk Read, so a Write Racing with the Read Can Veto Its insert() */
+    uint64_t version(const K &key) {
+        Shard &s = shardOf(key);
+        lock_guard<mutex> g(s.lock);
+        return s.version;
+    }
+
+    void insert(const K &key, const V &value, uint64_t ver) {
+        Shard &s = shardOf(key);
+        lock_guard<mutex> g(s.lock);
+        if (s.version != ver) { return; }
+        auto found = s.index.find(key);
+        if (found != s.index.end()) { eraseLocked(s, found->second); }
+        s.lru.push_front(make_pair(key, value));
+        size_t c = charge(s.lru.front());
+        if (c > shardCapacity) { s.lru.pop_front(); return; }
+        s.index[key] = s.lru.begin();
+        s.usage += c;
+        while (s.usage > shardCapacity) { eraseLocked(s, prev(s.lru.end())); }
+    }
+
+    void erase(const K &key) {
+        Shard &s = shardOf(key);
+        lock_guard<mutex> g(s.lock);
+        ++s.version;
+        auto found = s.index.find(key);
+        if (found != s.index.end()) { eraseLocked(s, found->second); }
+    }
+
+    /* Drop Every Cached Key in [begin, end); Costs a Seek per Shard Plus the Keys Erased */
+    void eraseRange(const K &begin, const K &end) {
+        for (auto &s : shards) {
+            lock_guard<mutex> g(s.lock);
+            ++s.version;
+            for (auto ite = s.index.lower_bound(begin); ite != s.index.end() && ite->first < end; ) {
+                s.usage -= charge(*ite->second);
+                s.lru.erase(ite->second);
+                ite = s.index.erase(ite);
+            }
+        }
+    }
+
+    void clear() {
+        for (auto &s : shards) {
+            lock_guard<mutex> g(s.lock);
+            ++s.version;
+            s.lru.clear(); s.index.clear(); s.usage = 0;
+        }
+    }
+
+    size_t usage() {
+        size_t ret = 0;
+        for (auto &s : shards) { lock_guard<mutex> g(s.lock); ret += s.usage; }
+        return ret;
+    }
+};
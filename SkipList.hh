@@ -1,19 +1,30 @@
 #pragma once
 
 #include <list>
+#include <ctime>
+#include <cstdlib>
+#include <typeinfo>
 #include <string>
 #include <vector>
 
 #define STRING
+/* malloc Header per Node, Roughly */
+#define SKIPLIST_ALLOC_OVERHEAD 16
 
 using namespace std;
 
+/* Stored as One Byte per Index Entry in SSTs */
+enum EntryType : uint8_t { ENTRY_VALUE = 0, ENTRY_DELETION = 1 };
+
 template<class K, class V>
 struct Entry {
-    Entry() {}
-    Entry(const K &k, const V &v): key(k), value(v) {}
+    Entry(): key(), type(ENTRY_VALUE) {}
+    Entry(const K &k, const V &v, EntryType t = ENTRY_VALUE): key(k), value(v), type(t) {}
     K key;
     V value;
+    EntryType type;
+
+    bool isDeletion() const { return type == ENTRY_DELETION; }
 };
 
 template <class T>
@@ -84,6 +95,17 @@ class SkipList {
 private:
     list<QuadList<Entry<K, V> > *> levels;
     uint32_t dataBytes;
+    /* Every Node of Every Level, Each Holding Its Own Copy of the Entry */
+    size_t nodeBytes;
+
+    static size_t charge(const Entry<K, V> &e) {
+        size_t c = sizeof(QuadListNode<Entry<K, V> >) + SKIPLIST_ALLOC_OVERHEAD;
+        /* String Limited */
+        #ifdef STRING
+        if (typeid(V) == typeid(string)) { c += e.value.size(); }
+        #endif
+        return c;
+    }
     
 protected:
     QuadListNode<Entry<K, V> > *skipSearch(const K &k, typename list<QuadList<Entry<K, V> > *>::iterator &q, QuadListNode<Entry<K, V> > *&p) {
@@ -99,13 +121,23 @@ protected:
         }
     }
 
+    /* Towers Only Shrink from the Top, so Emptied Levels Are Always the Front Ones */
+    void dropEmptyLevels() {
+        while (!levels.empty() && levels.front()->empty()) {
+            delete levels.front();
+            levels.erase(levels.begin());
+        }
+    }
+
 public:
-    explicit SkipList(): dataBytes(0) { srand(time(0)); }
+    explicit SkipList(): dataBytes(0), nodeBytes(0) { srand(time(0)); }
     ~SkipList() { for (auto i = levels.begin(); i != levels.end(); ++i) { delete *i; } }
     int size() { return levels.empty() ? 0 : levels.back()->size(); }
     int dataSize() { return dataBytes; }
-    uint32_t put(const K &key, const V &val) {
-        Entry<K, V> e = Entry<K, V>(key, val);
+    /* Memory Actually Held, Level Sentinels and Allocator Overhead Included */
+    size_t memoryUsage() { return nodeBytes + levels.size() * (sizeof(QuadList<Entry<K, V> >) + 2 * charge(Entry<K, V>())); }
+    uint32_t put(const K &key, const V &val, EntryType type = ENTRY_VALUE) {
+        Entry<K, V> e = Entry<K, V>(key, val, type);
         if (levels.empty()) { levels.push_front(new QuadList<Entry<K, V> >()); }
 
         auto q = levels.begin();
@@ -118,6 +150,7 @@ public:
             if (typeid(V) == typeid(string)) { dataBytes += val.size() - exist->entry.value.size(); }
             #endif
             while (p) {
+                nodeBytes += charge(e) - charge(p->entry);
                 p->entry = e;
                 p = p->below;
             } 
@@ -127,6 +160,7 @@ public:
         --q;
 
         QuadListNode<Entry<K, V> > *b = (*q)->insertAfterAbove(e, p);
+        nodeBytes += charge(e);
 
         while (rand() & 1) {
             while (p->pred && !p->above) { p = p->pred; }
@@ -142,6 +176,7 @@ public:
             }
 
             b = (*q)->insertAfterAbove(e, p, b);
+            nodeBytes += charge(e);
         }
 
         /* String Limited */
@@ -153,11 +188,28 @@ public:
     }
 
     V *get(const K &key) {
+        Entry<K, V> *res = find(key);
+        return res ? &(res->value) : nullptr;
+    }
+
+    /* Unlike get(), Exposes the Entry Type, so Tombstones Can Be Told Apart */
+    Entry<K, V> *find(const K &key) {
         if (levels.empty()) { return nullptr; }
         auto q = levels.begin();
         QuadListNode<Entry<K, V> > *p = (*q)->first();
         QuadListNode<Entry<K, V> > *res = skipSearch(key, q, p);
-        return res ? &(res->entry.value) : nullptr;
+        return res ? &(res->entry) : nullptr;
+    }
+
+    /* Whether Any Key, Tombstones Included, Falls in [low, high] */
+    bool intersects(const K &low, const K &high) {
+        if (levels.empty()) { return false; }
+        auto q = levels.begin();
+        QuadListNode<Entry<K, V> > *p = (*q)->first();
+        if (skipSearch(low, q, p)) { return true; }
+        /* p Is the Last Bottom-Level Node Below low, or the Header */
+        p = p->succ;
+        return p->succ && !(high < p->entry.key);
     }
 
     bool remove(const K &key) {
@@ -168,26 +220,72 @@ public:
 
         if (!skipSearch(key, q, p)) { return false; }
 
+        /* String Limited */
+        #ifdef STRING
+        if (typeid(V) == typeid(string)) { dataBytes -= p->entry.value.size(); }
+        #endif
+
         do {
             QuadListNode<Entry<K, V> > *lower = p->below;
+            nodeBytes -= charge(p->entry);
             (*q)->remove(p);
             p = lower; ++q;
         } while(q != levels.end());
 
-        while (!levels.empty() && levels.front()->empty()) { levels.erase(levels.begin()); }
+        dropEmptyLevels();
 
         return true;
     }
 
+    /* Remove Every Key in [begin, end), Return the Number Removed; Seeks to begin, Then Unlinks Whole Towers */
+    int removeRange(const K &begin, const K &end) {
+        if (levels.empty()) { return 0; }
+        auto q = levels.begin();
+        QuadListNode<Entry<K, V> > *p = (*q)->first();
+        QuadListNode<Entry<K, V> > *x = skipSearch(begin, q, p);
+        if (x) { while (x->below) { x = x->below; } }
+        /* p Is the Last Bottom-Level Node Below begin, or the Header */
+        else { x = p->succ; }
+
+        int removed = 0;
+        while (x->succ && x->entry.key < end) {
+            QuadListNode<Entry<K, V> > *next = x->succ;
+            /* String Limited */
+            #ifdef STRING
+            if (typeid(V) == typeid(string)) { dataBytes -= x->entry.value.size(); }
+            #endif
+            auto level = levels.end();
+            for (QuadListNode<Entry<K, V> > *n = x; n; ) {
+                QuadListNode<Entry<K, V> > *up = n->above;
+                nodeBytes -= charge(n->entry);
+                (*--level)->remove(n);
+                n = up;
+            }
+            x = next;
+            ++removed;
+        }
+        dropEmptyLevels();
+        return removed;
+    }
+
     void reset() {
         for (auto i = levels.begin(); i != levels.end(); ++i) { delete *i; }
         levels.clear();
         srand(time(0));
         dataBytes = 0;
+        nodeBytes = 0;
+    }
+
+    /* Visit Every Entry in Key Order Along the Bottom Level, Without Copying */
+    template<class F>
+    void scan(F f) {
+        if (levels.empty()) { return; }
+        for (QuadListNode<Entry<K, V> > *ite = levels.back()->first(); ite->succ; ite = ite->succ) { f(ite->entry); }
     }
 
     vector<Entry<K, V> > data() {
         vector<Entry<K, V> > ret;
+        if (levels.empty()) { return ret; }
         QuadListNode<Entry<K, V> > *ite = levels.back()->first();
         while (ite->succ) {
             ret.push_back(ite->entry);
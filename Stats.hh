@@ -0,0 +1,231 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+using namespace std;
+
+#define STATS_MAX_LEVEL 16
+/* Bucket i < 4 Holds Exactly i; Above, 4 Linear Sub-Buckets per Power of Two */
+#define HIST_SUB_BUCKETS 4
+#define HIST_BUCKETS (HIST_SUB_BUCKETS + 62 * HIST_SUB_BUCKETS)
+
+enum OpType { OP_PUT, OP_GET, OP_REMOVE, OP_REMOVE_RANGE, OP_FLUSH, OP_COMPACT, OP_NUM };
+
+static const char *OP_NAMES[OP_NUM] = { "put", "get", "remove", "remove_range", "flush", "compact" };
+
+/* Lock-Free Log-Linear Latency Histogram, Values in Nanoseconds */
+class Histogram {
+private:
+    atomic<uint64_t> buckets[HIST_BUCKETS];
+    atomic<uint64_t> count;
+    atomic<uint64_t> sum;
+    atomic<uint64_t> max;
+
+    static uint32_t bucketOf(uint64_t v) {
+        if (v < HIST_SUB_BUCKETS) { return v; }
+        uint32_t e = 63 - __builtin_clzll(v);
+        uint32_t sub = (v >> (e - 2)) & (HIST_SUB_BUCKETS - 1);
+        return HIST_SUB_BUCKETS + (e - 2) * HIST_SUB_BUCKETS + sub;
+    }
+
+    /* Upper Bound (Inclusive) of Values Falling in Bucket b */
+    static uint64_t bucketLimit(uint32_t b) {
+        if (b < HIST_SUB_BUCKETS) { return b; }
+        uint32_t e = (b - HIST_SUB_BUCKETS) / HIST_SUB_BUCKETS + 2;
+        uint64_t sub = (b - HIST_SUB_BUCKETS) % HIST_SUB_BUCKETS;
+        return ((HIST_SUB_BUCKETS + sub + 1) << (e - 2)) - 1;
+    }
+
+public:
+    Histogram() { clear(); }
+
+    void add(uint64_t v) {
+        buckets[bucketOf(v)].fetch_add(1, memory_order_relaxed);
+        count.fetch_add(1, memory_order_relaxed);
+        sum.fetch_add(v, memory_order_relaxed);
+        uint64_t cur = max.load(memory_order_relaxed);
+        while (v > cur && !max.compare_exchange_weak(cur, v, memory_order_relaxed)) {}
+    }
+
+    void merge(const Histogram &ano) {
+        for (uint32_t b = 0; b < HIST_BUCKETS; ++b) { buckets[b].fetch_add(ano.buckets[b].load(memory_order_relaxed), memory_order_relaxed); }
+        count.fetch_add(ano.getCount(), memory_order_relaxed);
+        sum.fetch_add(ano.sum.load(memory_order_relaxed), memory_order_relaxed);
+        uint64_t cur = max.load(memory_order_relaxed), v = ano.getMax();
+        while (v > cur && !max.compare_exchange_weak(cur, v, memory_order_relaxed)) {}
+    }
+
+    void clear() {
+        for (auto &b : buckets) { b.store(0, memory_order_relaxed); }
+        count.store(0); sum.store(0); max.store(0);
+    }
+
+    uint64_t getCount() const { return count.load(memory_order_relaxed); }
+    uint64_t getMax() const { return max.load(memory_order_relaxed); }
+    double average() const { uint64_t n = getCount(); return n ? double(sum.load(memory_order_relaxed)) / n : 0; }
+
+    /* p in [0, 100]; Returns the Upper Bound of the Bucket Holding the p-th Percentile */
+    uint64_t percentile(double p) const {
+        uint64_t n = getCount();
+        if (n == 0) { return 0; }
+        uint64_t rank = uint64_t(p / 100 * n), seen = 0;
+        if (rank >= n) { rank = n - 1; }
+        for (uint32_t b = 0; b < HIST_BUCKETS; ++b) {
+            seen += buckets[b].load(memory_order_relaxed);
+            if (seen > rank) { return min(bucketLimit(b), getMax()); }
+        }
+        return getMax();
+    }
+};
+
+struct LevelStats {
+    atomic<uint64_t> bytesRead{0};
+    atomic<uint64_t> bytesWritten{0};
+    atomic<uint64_t> fileNum{0};
+    atomic<uint64_t> fileBytes{0};
+};
+
+class Statistics {
+public:
+    Histogram latency[OP_NUM];
+
+    /* Bytes Handed in by put(), the Denominator of Write Amplification */
+    atomic<uint64_t> userBytesWritten{0};
+
+    atomic<uint64_t> bloomProbes{0};
+    atomic<uint64_t> bloomTrueNegatives{0};
+    atomic<uint64_t> bloomFalsePositives{0};
+
+    atomic<uint64_t> memTabHits{0};
+    atomic<uint64_t> memTabMisses{0};
+
+    atomic<uint64_t> rowCacheHits{0};
+    atomic<uint64_t> rowCacheMisses{0};
+
+    /* Key-Range Pieces Merged in Parallel */
+    atomic<uint64_t> subcompactions{0};
+
+    /* Writes Metered by the Write Controller, Writes Held at a Stop Mark, and the Time They Spent Waiting */
+    atomic<uint64_t> delayedWrites{0};
+    atomic<uint64_t> stoppedWrites{0};
+    atomic<uint64_t> writeDelayNanos{0};
+
+    /* SSTs Set Aside as <name>.bad at Open Because Their Header Did Not Parse; Kept Across reset() */
+    atomic<uint64_t> badFiles{0};
+
+    LevelStats level[STATS_MAX_LEVEL];
+
+    void addRead(uint32_t l, uint64_t bytes) { if (l < STATS_MAX_LEVEL) { level[l].bytesRead.fetch_add(bytes, memory_order_relaxed); } }
+    void addWritten(uint32_t l, uint64_t bytes) { if (l < STATS_MAX_LEVEL) { level[l].bytesWritten.fetch_add(bytes, memory_order_relaxed); } }
+
+    void setLevelShape(uint32_t l, uint64_t files, uint64_t bytes) {
+        if (l >= STATS_MAX_LEVEL) { return; }
+        level[l].fileNum.store(files, memory_order_relaxed);
+        level[l].fileBytes.store(bytes, memory_order_relaxed);
+    }
+
+    double writeAmplification() const {
+        uint64_t user = userBytesWritten.load(), disk = 0;
+        for (auto &l : level) { disk += l.bytesWritten.load(); }
+        return user ? double(disk) / user : 0;
+    }
+
+    double memTabHitRate() const {
+        uint64_t h = memTabHits.load(), m = memTabMisses.load();
+        return h + m ? double(h) / (h + m) : 0;
+    }
+
+    void reset() {
+        for (auto &h : latency) { h.clear(); }
+        userBytesWritten = 0;
+        bloomProbes = 0; bloomTrueNegatives = 0; bloomFalsePositives = 0;
+        memTabHits = 0; memTabMisses = 0;
+        rowCacheHits = 0; rowCacheMisses = 0;
+        subcompactions = 0;
+        delayedWrites = 0; stoppedWrites = 0; writeDelayNanos = 0;
+        for (auto &l : level) { l.bytesRead = 0; l.bytesWritten = 0; }
+    }
+
+    string toString() const {
+        ostringstream out;
+        out << fixed << setprecision(2);
+        out << "** Latency (us) **" << endl;
+        for (int i = 0; i < OP_NUM; ++i) {
+            const Histogram &h = latency[i];
+            out << setw(12) << OP_NAMES[i] << ": count " << h.getCount()
+                << " avg " << h.average() / 1000 << " p50 " << h.percentile(50) / 1000.0
+                << " p99 " << h.percentile(99) / 1000.0 << " p999 " << h.percentile(99.9) / 1000.0
+                << " max " << h.getMax() / 1000.0 << endl;
+        }
+        out << "** Levels **" << endl;
+        for (int i = 0; i < STATS_MAX_LEVEL; ++i) {
+            const LevelStats &l = level[i];
+            if (!l.fileNum && !l.bytesRead && !l.bytesWritten) { continue; }
+            out << "  L" << i << ": files " << l.fileNum << " size " << l.fileBytes
+                << " read " << l.bytesRead << " written " << l.bytesWritten << endl;
+        }
+        out << "** Misc **" << endl;
+        out << "  write amplification: " << writeAmplification() << endl;
+        out << "  bloom probes: " << bloomProbes << " true negatives: " << bloomTrueNegatives
+            << " false positives: " << bloomFalsePositives << endl;
+        out << "  memtable hits: " << memTabHits << " misses: " << memTabMisses
+            << " hit rate: " << memTabHitRate() << endl;
+        out << "  row cache hits: " << rowCacheHits << " misses: " << rowCacheMisses << endl;
+        out << "  subcompactions: " << subcompactions << endl;
+        out << "  write delays: " << delayedWrites << " stops: " << stoppedWrites
+            << " waited (us): " << writeDelayNanos / 1000.0 << endl;
+        out << "  files set aside at open: " << badFiles << endl;
+        return out.str();
+    }
+
+    string toJSON() const {
+        ostringstream out;
+        out << "{\"latency_ns\":{";
+        for (int i = 0; i < OP_NUM; ++i) {
+            const Histogram &h = latency[i];
+            out << (i ? "," : "") << '"' << OP_NAMES[i] << "\":{\"count\":" << h.getCount()
+                << ",\"avg\":" << uint64_t(h.average()) << ",\"p50\":" << h.percentile(50)
+                << ",\"p99\":" << h.percentile(99) << ",\"p999\":" << h.percentile(99.9)
+                << ",\"max\":" << h.getMax() << '}';
+        }
+        out << "},\"levels\":[";
+        bool first = true;
+        for (int i = 0; i < STATS_MAX_LEVEL; ++i) {
+            const LevelStats &l = level[i];
+            if (!l.fileNum && !l.bytesRead && !l.bytesWritten) { continue; }
+            out << (first ? "" : ",") << "{\"level\":" << i << ",\"files\":" << l.fileNum
+                << ",\"size\":" << l.fileBytes << ",\"bytes_read\":" << l.bytesRead
+                << ",\"bytes_written\":" << l.bytesWritten << '}';
+            first = false;
+        }
+        out << "],\"write_amplification\":" << writeAmplification()
+            << ",\"user_bytes_written\":" << userBytesWritten
+            << ",\"bloom\":{\"probes\":" << bloomProbes << ",\"true_negatives\":" << bloomTrueNegatives
+            << ",\"false_positives\":" << bloomFalsePositives << '}'
+            << ",\"memtable\":{\"hits\":" << memTabHits << ",\"misses\":" << memTabMisses
+            << ",\"hit_rate\":" << memTabHitRate() << '}'
+            << ",\"row_cache\":{\"hits\":" << rowCacheHits << ",\"misses\":" << rowCacheMisses << '}'
+            << ",\"subcompactions\":" << subcompactions
+            << ",\"write_controller\":{\"delayed\":" << delayedWrites << ",\"stopped\":" << stoppedWrites
+            << ",\"wait_ns\":" << writeDelayNanos << '}'
+            << ",\"bad_files\":" << badFiles << '}';
+        return out.str();
+    }
+};
+
+/* Records Elapsed Wall-Clock Time into a Histogram When Going out of Scope */
+class StopWatch {
+private:
+    Histogram *hist;
+    chrono::steady_clock::time_point start;
+public:
+    explicit StopWatch(Histogram *h): hist(h), start(chrono::steady_clock::now()) {}
+    ~StopWatch() {
+        if (hist) { hist->add(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count()); }
+    }
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+using namespace std;
+
+/* Fixed Set of Workers Draining a FIFO of Tasks */
+class ThreadPool {
+private:
+    vector<thread> workers;
+    queue<function<void()> > tasks;
+    mutex lock;
+    condition_variable cond;
+    bool stopping;
+
+    void work() {
+        while (true) {
+            function<void()> task;
+            {
+                unique_lock<mutex> g(lock);
+                cond.wait(g, [this]() { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty()) { return; }
+                task = move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+
+public:
+    explicit ThreadPool(uint32_t n): stopping(false) {
+        if (n == 0) { n = 1; }
+        for (uint32_t i = 0; i < n; ++i) { workers.emplace_back(&ThreadPool::work, this); }
+    }
+
+    /* Pending Tasks Still Run Before the Workers Exit */
+    ~ThreadPool() {
+        { lock_guard<mutex> g(lock); stopping = true; }
+        cond.notify_all();
+        for (auto &w : workers) { w.join(); }
+    }
+
+    void post(function<void()> task) {
+        { lock_guard<mutex> g(lock); tasks.push(move(task)); }
+        cond.notify_one();
+    }
+
+    template<class F>
+    auto submit(F f) -> future<decltype(f())> {
+        auto task = make_shared<packaged_task<decltype(f())()> >(move(f));
+        future<decltype(f())> ret = task->get_future();
+        post([task]() { (*task)(); });
+        return ret;
+    }
+
+    uint32_t size() const { return workers.size(); }
+};
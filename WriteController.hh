@@ -0,0 +1,69 @@
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+#include "Stats.hh"
+
+using namespace std;
+
+/* Metered Debt Below This Is Let Through at Once, Sleeping Only in Slices Worth Waking for */
+#define WRITE_DELAY_MIN_NANOS 1000000
+
+/* Paces Writers Once Compaction Falls Behind. Between the Slowdown and Stop Marks, Writes Are Metered at a Rate
+ * Falling Linearly from delayedWriteRate Toward Zero; at a Stop Mark They Wait Until Compaction Catches up */
+class WriteController {
+private:
+    mutex lock;
+    condition_variable cond;
+    double maxRate;
+    /* Bytes per Second; 0 When Writes Are Not Metered */
+    double rate;
+    bool stopped;
+    /* When the Bytes Metered So Far Are Paid off */
+    chrono::steady_clock::time_point next;
+    Statistics *stats;
+
+public:
+    explicit WriteController(uint64_t delayedWriteRate, Statistics *_stats = nullptr)
+        : maxRate(delayedWriteRate), rate(0), stopped(false), next(chrono::steady_clock::now()), stats(_stats) {}
+
+    /* pressure <= 0 Lets Writes Through, in (0, 1) Meters Them, >= 1 Stops Them */
+    void update(double pressure) {
+        {
+            lock_guard<mutex> g(lock);
+            stopped = pressure >= 1;
+            rate = pressure <= 0 || stopped ? 0 : maxRate * (1 - pressure);
+        }
+        cond.notify_all();
+    }
+
+    /* Wait Until bytes May Be Written; Return Whether It Had to Wait */
+    bool admit(uint64_t bytes) {
+        unique_lock<mutex> g(lock);
+        if (!stopped && rate == 0) { return false; }
+        auto start = chrono::steady_clock::now();
+        bool waited = false;
+        if (stopped) {
+            if (stats) { stats->stoppedWrites.fetch_add(1, memory_order_relaxed); }
+            cond.wait(g, [this]() { return !stopped; });
+            waited = true;
+        }
+        if (rate > 0) {
+            auto now = chrono::steady_clock::now();
+            next = max(next, now) + chrono::nanoseconds(uint64_t(bytes * 1e9 / rate));
+            auto until = next;
+            if (until - now >= chrono::nanoseconds(WRITE_DELAY_MIN_NANOS)) {
+                if (stats) { stats->delayedWrites.fetch_add(1, memory_order_relaxed); }
+                g.unlock();
+                this_thread::sleep_until(until);
+                waited = true;
+            }
+        }
+        if (waited && stats) {
+            stats->writeDelayNanos.fetch_add(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count(), memory_order_relaxed);
+        }
+        return waited;
+    }
+};
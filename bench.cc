@@ -0,0 +1,381 @@
+#include "LSM.hh"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <functional>
+
+using namespace std;
+
+/* Usage: bench [--benchmarks=fillseq,readrandom,...] [--num=N] [--reads=N] [--threads=T]
+ *              [--value_size=S] [--value_size_min=A --value_size_max=B]
+ *              [--distribution=uniform|zipfian|latest] [--db=DIR] [--format=text|json] [--seed=X]
+ *              [--row_cache_bytes=B] [--batch=N] [--io_uring=0|1] [--subcompactions=N]
+ *              [--memtable_bytes=B] [--delayed_write_rate=B]
+ *
+ * Workloads: fillseq fillrandom bulkload overwrite readrandom readmissing readseq deleterandom
+ *            multireadrandom ycsba ycsbb ycsbc ycsbd ycsbe ycsbf
+ * multireadrandom Issues --batch Lookups per Op Through multiGet(), All Disk Reads in Flight Together.
+ * bulkload Writes Sorted SSTs with SSTWriter and Ingests Them, Bypassing the MemTable.
+ * fill* and bulkload Start From an Empty Database; the Others Run on Whatever the Previous Workload Left.
+ * With --threads, Reads Run in Parallel While Writes Queue Inside the LSM, One at a Time. */
+
+struct Config {
+    string benchmarks = "fillseq,fillrandom,overwrite,readrandom,readmissing,readseq,deleterandom";
+    string db = "./bench_data";
+    string format = "text";
+    string distribution = "";
+    uint64_t num = 1 << 20;
+    uint64_t reads = 0;
+    uint32_t threads = 1;
+    uint32_t valueMin = 100;
+    uint32_t valueMax = 100;
+    uint64_t seed = 301;
+    uint32_t batch = 32;
+    Options opt;
+};
+
+/* YCSB Zipfian Generator (Gray et al., "Quickly Generating Billion-Record Synthetic Databases") */
+class Zipfian {
+private:
+    uint64_t items;
+    double theta, zetan, alpha, eta;
+
+    static double zeta(uint64_t n, double theta) {
+        double sum = 0;
+        for (uint64_t i = 1; i <= n; ++i) { sum += 1 / pow(double(i), theta); }
+        return sum;
+    }
+
+public:
+    explicit Zipfian(uint64_t n, double _theta = 0.99): items(n), theta(_theta) {
+        double zeta2 = zeta(2, theta);
+        zetan = zeta(n, theta);
+        alpha = 1 / (1 - theta);
+        eta = (1 - pow(2.0 / n, 1 - theta)) / (1 - zeta2 / zetan);
+    }
+
+    /* Rank in [0, items), 0 Being the Hottest */
+    uint64_t next(mt19937_64 &rng) const {
+        double u = uniform_real_distribution<double>(0, 1)(rng);
+        double uz = u * zetan;
+        if (uz < 1) { return 0; }
+        if (uz < 1 + pow(0.5, theta)) { return 1; }
+        uint64_t ret = uint64_t(items * pow(eta * u - eta + 1, alpha));
+        return ret < items ? ret : items - 1;
+    }
+};
+
+/* FNV-1a, Used to Scatter Zipfian Ranks over the Key Space */
+static uint64_t fnvHash(uint64_t v) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (int i = 0; i < 8; ++i) { h ^= v & 0xFF; h *= 0x100000001B3ULL; v >>= 8; }
+    return h;
+}
+
+enum Dist { DIST_UNIFORM, DIST_ZIPFIAN, DIST_LATEST };
+
+class KeyChooser {
+private:
+    Dist dist;
+    const Zipfian *zipf;
+    const atomic<uint64_t> *keyNum;
+public:
+    KeyChooser(Dist d, const Zipfian *z, const atomic<uint64_t> *n): dist(d), zipf(z), keyNum(n) {}
+
+    uint64_t next(mt19937_64 &rng) const {
+        uint64_t n = keyNum->load(memory_order_relaxed);
+        switch (dist) {
+            case DIST_ZIPFIAN: return fnvHash(zipf->next(rng)) % n;
+            case DIST_LATEST: { uint64_t r = zipf->next(rng) % n; return n - 1 - r; }
+            default: return uniform_int_distribution<uint64_t>(0, n - 1)(rng);
+        }
+    }
+};
+
+struct Result {
+    string name;
+    uint64_t ops = 0;
+    uint64_t found = 0;
+    uint64_t bytes = 0;
+    double seconds = 0;
+    Histogram latency;
+};
+
+class Benchmark {
+private:
+    Config cfg;
+    LSM<uint64_t, string> lsm;
+    string valuePool;
+    atomic<uint64_t> keyNum;
+
+    string makeValue(mt19937_64 &rng) {
+        uint32_t len = uniform_int_distribution<uint32_t>(cfg.valueMin, cfg.valueMax)(rng);
+        uint64_t pos = uniform_int_distribution<uint64_t>(0, valuePool.size() - len)(rng);
+        return valuePool.substr(pos, len);
+    }
+
+    void doPut(Result &r, uint64_t key, mt19937_64 &rng) {
+        string v = makeValue(rng);
+        lsm.put(key, v);
+        r.bytes += sizeof(key) + v.size();
+    }
+
+    bool doGet(Result &r, uint64_t key) {
+        string v;
+        bool found = lsm.get(key, &v);
+        r.bytes += sizeof(key) + v.size();
+        return found;
+    }
+
+    void doRemove(Result &r, uint64_t key) {
+        lsm.remove(key);
+    }
+
+    /* Operation i of Thread tid, Out of ops per Thread */
+    typedef function<void(Result &, uint32_t tid, uint64_t i, uint64_t ops, mt19937_64 &rng)> Op;
+
+    void ycsb(Result &r, mt19937_64 &rng, const KeyChooser &chooser, double readP, double updateP, double insertP, double scanP) {
+        double p = uniform_real_distribution<double>(0, 1)(rng);
+        if (p < readP) { r.found += doGet(r, chooser.next(rng)); }
+        else if (p < readP + updateP) { doPut(r, chooser.next(rng), rng); }
+        else if (p < readP + updateP + insertP) { doPut(r, keyNum.fetch_add(1), rng); }
+        else if (p < readP + updateP + insertP + scanP) {
+            /* No Iterator Yet: a Scan Is a Run of Point Lookups over Consecutive Keys */
+            uint64_t start = chooser.next(rng), len = uniform_int_distribution<uint64_t>(1, 100)(rng);
+            for (uint64_t k = start; k < start + len; ++k) { r.found += doGet(r, k); }
+        }
+        else {
+            /* Read-Modify-Write */
+            uint64_t key = chooser.next(rng);
+            r.found += doGet(r, key);
+            doPut(r, key, rng);
+        }
+    }
+
+    void run(Result &r, const string &name, uint64_t ops, const Op &op) {
+        r.name = name;
+        vector<Result> perThread(cfg.threads);
+        vector<thread> workers;
+        uint64_t perOps = ops / cfg.threads;
+        auto start = chrono::steady_clock::now();
+        for (uint32_t t = 0; t < cfg.threads; ++t) {
+            workers.emplace_back([&, t]() {
+                mt19937_64 rng(cfg.seed + t * 7919 + hash<string>()(name));
+                uint64_t n = t + 1 == cfg.threads ? ops - perOps * t : perOps;
+                for (uint64_t i = 0; i < n; ++i) {
+                    auto opStart = chrono::steady_clock::now();
+                    op(perThread[t], t, perOps * t + i, n, rng);
+                    perThread[t].latency.add(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - opStart).count());
+                }
+            });
+        }
+        for (auto &w : workers) { w.join(); }
+        r.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        for (auto &p : perThread) { r.found += p.found; r.bytes += p.bytes; }
+        /* Each Thread Owns Its Histogram; a Scan or Read-Modify-Write Counts as One Op */
+        for (auto &p : perThread) { r.latency.merge(p.latency); }
+        r.ops = r.latency.getCount();
+    }
+
+    Dist distOf(Dist fallback) {
+        if (cfg.distribution == "uniform") { return DIST_UNIFORM; }
+        if (cfg.distribution == "zipfian") { return DIST_ZIPFIAN; }
+        if (cfg.distribution == "latest") { return DIST_LATEST; }
+        return fallback;
+    }
+
+public:
+    explicit Benchmark(const Config &_cfg): cfg(_cfg), lsm(_cfg.db, _cfg.opt), keyNum(_cfg.num) {
+        mt19937_64 rng(cfg.seed);
+        valuePool.resize(cfg.valueMax + (1 << 20));
+        for (auto &c : valuePool) { c = 'a' + rng() % 26; }
+    }
+
+    bool runOne(const string &name, Result &r) {
+        uint64_t num = cfg.num, reads = cfg.reads ? cfg.reads : cfg.num;
+        Zipfian zipf(num);
+        if (name == "fillseq" || name == "fillrandom") {
+            lsm.reset(); keyNum = num;
+            bool seq = name == "fillseq";
+            run(r, name, num, [&](Result &res, uint32_t, uint64_t i, uint64_t, mt19937_64 &rng) {
+                doPut(res, seq ? i : uniform_int_distribution<uint64_t>(0, num - 1)(rng), rng);
+            });
+        }
+        else if (name == "bulkload") {
+            /* Sorted Keys Cut into SSTs by SSTWriter, Then Handed to ingestFiles(); Timed as a Whole */
+            lsm.reset(); keyNum = num;
+            string src = cfg.db + "_ingest";
+            remove_all(src); create_directory(src);
+            mt19937_64 rng(cfg.seed);
+            vector<string> paths;
+            SSTWriter<uint64_t, string> writer;
+            auto start = chrono::steady_clock::now();
+            for (uint64_t i = 0; i < num; ++i) {
+                string v = makeValue(rng);
+                writer.add(i, v);
+                r.bytes += sizeof(i) + v.size();
+                if (writer.fileBytes() >= MEM_MAX_BYTES || i + 1 == num) {
+                    paths.push_back(src + '/' + to_string(paths.size()) + ".sst");
+                    writer.finish(paths.back());
+                }
+            }
+            bool ok = lsm.ingestFiles(paths, true);
+            r.name = name; r.ops = num;
+            r.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            remove_all(src);
+            if (!ok) { cerr << "bulkload: ingestion failed" << endl; }
+        }
+        else if (name == "overwrite") {
+            run(r, name, num, [&](Result &res, uint32_t, uint64_t, uint64_t, mt19937_64 &rng) {
+                doPut(res, uniform_int_distribution<uint64_t>(0, num - 1)(rng), rng);
+            });
+        }
+        else if (name == "readrandom" || name == "readmissing") {
+            /* Missing Keys Live Past Every Key the Fill Workloads Produce */
+            uint64_t base = name == "readmissing" ? keyNum.load() : 0;
+            KeyChooser chooser(distOf(DIST_UNIFORM), &zipf, &keyNum);
+            run(r, name, reads, [&](Result &res, uint32_t, uint64_t, uint64_t, mt19937_64 &rng) {
+                res.found += doGet(res, base + chooser.next(rng));
+            });
+        }
+        else if (name == "multireadrandom") {
+            KeyChooser chooser(distOf(DIST_UNIFORM), &zipf, &keyNum);
+            run(r, name, (reads + cfg.batch - 1) / cfg.batch, [&](Result &res, uint32_t, uint64_t, uint64_t, mt19937_64 &rng) {
+                vector<uint64_t> keys;
+                for (uint32_t i = 0; i < cfg.batch; ++i) { keys.push_back(chooser.next(rng)); }
+                vector<pair<bool, string> > got = lsm.multiGet(keys);
+                for (auto &p : got) { res.found += p.first; res.bytes += sizeof(uint64_t) + p.second.size(); }
+            });
+        }
+        else if (name == "readseq") {
+            run(r, name, reads, [&](Result &res, uint32_t, uint64_t i, uint64_t, mt19937_64 &) {
+                res.found += doGet(res, i % num);
+            });
+        }
+        else if (name == "deleterandom") {
+            run(r, name, num, [&](Result &res, uint32_t, uint64_t, uint64_t, mt19937_64 &rng) {
+                doRemove(res, uniform_int_distribution<uint64_t>(0, num - 1)(rng));
+            });
+        }
+        else if (name.size() == 5 && name.compare(0, 4, "ycsb") == 0 && name[4] >= 'a' && name[4] <= 'f') {
+            /* Read / Update / Insert / Scan Proportions; the Remainder Is Read-Modify-Write */
+            static const double mix[6][4] = {
+                { 0.50, 0.50, 0.00, 0.00 }, { 0.95, 0.05, 0.00, 0.00 }, { 1.00, 0.00, 0.00, 0.00 },
+                { 0.95, 0.00, 0.05, 0.00 }, { 0.00, 0.00, 0.05, 0.95 }, { 0.50, 0.00, 0.00, 0.00 },
+            };
+            int w = name[4] - 'a';
+            KeyChooser chooser(distOf(w == 3 ? DIST_LATEST : DIST_ZIPFIAN), &zipf, &keyNum);
+            run(r, name, reads, [&](Result &res, uint32_t, uint64_t, uint64_t, mt19937_64 &rng) {
+                ycsb(res, rng, chooser, mix[w][0], mix[w][1], mix[w][2], mix[w][3]);
+            });
+        }
+        else { return false; }
+        return true;
+    }
+
+    const Config &config() const { return cfg; }
+    LSM<uint64_t, string> &db() { return lsm; }
+};
+
+static string textLine(const Result &r) {
+    ostringstream out;
+    out << fixed << setprecision(3);
+    double micros = r.ops ? r.seconds * 1e6 / r.ops : 0;
+    out << left << setw(16) << r.name << ": " << right << setw(10) << micros << " micros/op "
+        << setw(10) << uint64_t(r.seconds ? r.ops / r.seconds : 0) << " ops/sec "
+        << setw(8) << (r.seconds ? r.bytes / r.seconds / 1048576 : 0) << " MB/s";
+    /* Workloads Timed Only as a Whole, Like bulkload, Have No Per-Op Samples */
+    if (r.latency.getCount()) {
+        out << "  p50 " << r.latency.percentile(50) / 1000.0 << " p99 " << r.latency.percentile(99) / 1000.0
+            << " p999 " << r.latency.percentile(99.9) / 1000.0 << " us";
+    }
+    else { out << "  p50 n/a p99 n/a p999 n/a"; }
+    if (r.found) { out << "  (" << r.found << " found)"; }
+    return out.str();
+}
+
+static string jsonObject(const Result &r) {
+    ostringstream out;
+    out << "{\"name\":\"" << r.name << "\",\"ops\":" << r.ops << ",\"seconds\":" << r.seconds
+        << ",\"ops_per_sec\":" << (r.seconds ? r.ops / r.seconds : 0)
+        << ",\"bytes\":" << r.bytes << ",\"found\":" << r.found << ",\"latency_ns\":";
+    if (r.latency.getCount()) {
+        out << "{\"avg\":" << uint64_t(r.latency.average()) << ",\"p50\":" << r.latency.percentile(50)
+            << ",\"p99\":" << r.latency.percentile(99) << ",\"p999\":" << r.latency.percentile(99.9)
+            << ",\"max\":" << r.latency.getMax() << '}';
+    }
+    else { out << "null"; }
+    out << '}';
+    return out.str();
+}
+
+static bool parseFlag(const string &arg, const string &name, string *value) {
+    string prefix = "--" + name + "=";
+    if (arg.compare(0, prefix.size(), prefix) != 0) { return false; }
+    *value = arg.substr(prefix.size());
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Config cfg;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i], v;
+        if (parseFlag(arg, "benchmarks", &v)) { cfg.benchmarks = v; }
+        else if (parseFlag(arg, "db", &v)) { cfg.db = v; }
+        else if (parseFlag(arg, "format", &v)) { cfg.format = v; }
+        else if (parseFlag(arg, "distribution", &v)) { cfg.distribution = v; }
+        else if (parseFlag(arg, "num", &v)) { cfg.num = stoull(v); }
+        else if (parseFlag(arg, "reads", &v)) { cfg.reads = stoull(v); }
+        else if (parseFlag(arg, "threads", &v)) { cfg.threads = stoul(v); }
+        else if (parseFlag(arg, "value_size", &v)) { cfg.valueMin = cfg.valueMax = stoul(v); }
+        else if (parseFlag(arg, "value_size_min", &v)) { cfg.valueMin = stoul(v); }
+        else if (parseFlag(arg, "value_size_max", &v)) { cfg.valueMax = stoul(v); }
+        else if (parseFlag(arg, "seed", &v)) { cfg.seed = stoull(v); }
+        else if (parseFlag(arg, "row_cache_bytes", &v)) { cfg.opt.rowCacheBytes = stoull(v); }
+        else if (parseFlag(arg, "batch", &v)) { cfg.batch = stoul(v); }
+        else if (parseFlag(arg, "io_uring", &v)) { cfg.opt.useIoUring = stoul(v); }
+        else if (parseFlag(arg, "subcompactions", &v)) { cfg.opt.subcompactions = stoul(v); }
+        else if (parseFlag(arg, "memtable_bytes", &v)) { cfg.opt.memTableBytes = stoull(v); }
+        else if (parseFlag(arg, "delayed_write_rate", &v)) { cfg.opt.delayedWriteRate = stoull(v); }
+        else { cerr << "Unknown flag: " << arg << endl; return 1; }
+    }
+    if (cfg.valueMin > cfg.valueMax || cfg.threads == 0 || cfg.num == 0 || cfg.batch == 0) { cerr << "Invalid configuration" << endl; return 1; }
+
+    Benchmark bench(cfg);
+    bool json = cfg.format == "json";
+    if (json) {
+        cout << "{\"config\":{\"num\":" << cfg.num << ",\"reads\":" << (cfg.reads ? cfg.reads : cfg.num)
+             << ",\"threads\":" << cfg.threads << ",\"value_size_min\":" << cfg.valueMin
+             << ",\"value_size_max\":" << cfg.valueMax << ",\"distribution\":\"" << cfg.distribution
+             << "\",\"seed\":" << cfg.seed << ",\"row_cache_bytes\":" << cfg.opt.rowCacheBytes
+             << ",\"batch\":" << cfg.batch << ",\"io_uring\":" << cfg.opt.useIoUring
+             << ",\"subcompactions\":" << cfg.opt.subcompactions << ",\"memtable_bytes\":" << cfg.opt.memTableBytes
+             << ",\"delayed_write_rate\":" << cfg.opt.delayedWriteRate << "},\"results\":[";
+    }
+    else {
+        cout << "Keys: " << cfg.num << "  Values: " << cfg.valueMin << '-' << cfg.valueMax
+             << " bytes  Threads: " << cfg.threads << endl << string(60, '-') << endl;
+    }
+
+    stringstream names(cfg.benchmarks);
+    string name;
+    bool first = true;
+    while (getline(names, name, ',')) {
+        if (name.empty()) { continue; }
+        Result r;
+        if (!bench.runOne(name, r)) { cerr << "Unknown benchmark: " << name << endl; continue; }
+        if (json) { cout << (first ? "" : ",") << jsonObject(r); }
+        else { cout << textLine(r) << endl; }
+        first = false;
+    }
+
+    if (json) { cout << "],\"stats\":" << bench.db().getStats().toJSON() << '}' << endl; }
+    else { cout << endl << bench.db().getStats().toString(); }
+    return 0;
+}
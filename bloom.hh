@@ -3,48 +3,60 @@
 #include <string>
 #include <vector>
 #include <cmath>
-#include <bitset>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
 
 using namespace std;
 
-#define MAX_FILTER_LEN 10000
+/* Three Hashes over Ten Bits a Key Leave About 2% False Positives, Whatever the File's Size */
+#define BLOOM_BITS_PER_KEY 10
+/* Size of the Filter Persisted in an SST of n Keys; Never Zero, so Probes Need No Special Case */
+#define FILTER_BYTES(n) max<uint32_t>(1, (uint64_t(n) * BLOOM_BITS_PER_KEY + 7) / 8)
 
 using namespace std;
 
 class bloom
 {
 private:
-    uint32_t hash1(uint64_t num) {
+    uint32_t hash1(uint64_t num) const {
         return num;
     }
 
-    uint32_t hash2(uint64_t num) {
+    uint32_t hash2(uint64_t num) const {
         uint64_t hash = num;
         hash = (hash<<16)^(hash<<32)^(hash<<48)^(hash>>16)^(hash>>32)^(hash>>48);
         return hash;
     }
 
-    uint32_t hash3(uint64_t num) {
+    uint32_t hash3(uint64_t num) const {
         uint64_t hash = num;
         hash = (hash<<8)^(hash<<24)^(hash<<40)^(hash>>8)^(hash>>24)^(hash>>40);
         return hash;
 }
 public:
-    explicit bloom() {}
+    explicit bloom(uint32_t bytes = 1): bits(bytes, 0) {}
     void insert(uint64_t num) { 
-        bitSet.set(hash1(num) % MAX_FILTER_LEN, 1);
-        bitSet.set(hash2(num) % MAX_FILTER_LEN, 1);
-        bitSet.set(hash3(num) % MAX_FILTER_LEN, 1);
+        set(hash1(num));
+        set(hash2(num));
+        set(hash3(num));
     }
-    bool isExist(uint64_t num) {
-        return bitSet.test(hash1(num) % MAX_FILTER_LEN) &&
-               bitSet.test(hash2(num) % MAX_FILTER_LEN) &&
-               bitSet.test(hash3(num) % MAX_FILTER_LEN);
+    bool isExist(uint64_t num) const {
+        return test(hash1(num)) && test(hash2(num)) && test(hash3(num));
     }
-    void clear() { bitSet.reset(); }
+    /* Empty, Resized to bytes */
+    void reset(uint32_t bytes) { bits.assign(bytes, 0); }
+
+    /* Persisted As Is: Bit i in Byte i / 8 */
+    uint32_t bytes() const { return bits.size(); }
+    const char *data() const { return (const char *)bits.data(); }
+    void load(const char *in, uint32_t bytes) { bits.assign(in, in + bytes); }
 
 protected:
-    bitset<MAX_FILTER_LEN> bitSet;
+    vector<uint8_t> bits;
+
+    void set(uint32_t h) { h %= bits.size() * 8; bits[h / 8] |= 1 << (h % 8); }
+    bool test(uint32_t h) const { h %= bits.size() * 8; return (bits[h / 8] >> (h % 8)) & 1; }
 };
 
 
@@ -9,6 +9,8 @@
 #include <time.h>
 
 #include <random>
+#include <thread>
+#include <atomic>
 
 #define TEST_SIZE (1 << 20)
 
@@ -62,15 +64,16 @@ void correctnessTest(LSM<uint64_t, string> &lsm, uint64_t size) {
     uint64_t cnt = 0;
     auto data = memTab.data();
     for (uint64_t i = 0; i < size; ++i) {
-        string lsmGet = lsm.get(i), *memGet = memTab.get(i);
+        string lsmGet, *memGet = memTab.get(i);
+        bool lsmFound = lsm.get(i, &lsmGet);
         if (memGet) {
-            if (lsmGet != *memGet) {
-                cout << "LSM get: "<< lsmGet << endl << "MenTable get: " << *memGet << endl;
+            if (!lsmFound || lsmGet != *memGet) {
+                cout << "LSM get: "<< (lsmFound ? lsmGet : "(not found)") << endl << "MenTable get: " << *memGet << endl;
             }
             else { ++cnt;}
         }
         else {
-            if (!lsmGet.empty()) { cout << "LSM get: "<< lsmGet << endl << "MenTable get: " << endl; }
+            if (lsmFound) { cout << "LSM get: "<< lsmGet << endl << "MenTable get: (not found)" << endl; }
             else { ++cnt; }
         }
     }
@@ -78,6 +81,188 @@ void correctnessTest(LSM<uint64_t, string> &lsm, uint64_t size) {
 
 }
 
+/* One Range Delete Must Hide Its Keys While in the MemTable, After a Flush and After Compaction, Sparing
+ * the Keys Either Side; a Second One Lands on Keys Already on Disk */
+void rangeDeleteTest(uint64_t size) {
+    Options opt; opt.memTableBytes = 1 << 18;
+    LSM<uint64_t, string> lsm("./data_range", opt);
+    lsm.reset();
+    uint64_t cnt = 0, total = 0, filler = size;
+    bool second = false;
+    auto check = [&]() {
+        for (uint64_t i = 0; i < size; ++i) {
+            bool deleted = (i >= size / 10 && i < size / 5) || (second && i >= size / 2 && i < size * 3 / 5);
+            string v;
+            cnt += lsm.get(i, &v) != deleted; ++total;
+        }
+    };
+    auto fillUntil = [&](function<bool()> done) {
+        while (!done()) { lsm.put(filler++, string(100, 'f')); }
+    };
+    auto compactions = [&]() { return lsm.getStats().latency[OP_COMPACT].getCount(); };
+
+    for (uint64_t i = 0; i < size; ++i) { lsm.put(i, to_string(i)); }
+    lsm.removeRange(size / 10, size / 5);
+    check();
+    fillUntil([&]() { return lsm.getStats().level[0].fileNum > 0; });
+    check();
+    fillUntil([&]() { return compactions() > 0; });
+    check();
+
+    lsm.removeRange(size / 2, size * 3 / 5);
+    second = true;
+    check();
+    uint64_t before = compactions();
+    fillUntil([&]() { return compactions() > before; });
+    check();
+    cout << "Range Delete Test Result: " << cnt << '/' << total << " => " << double(cnt) / total * 100 << '%' << endl;
+}
+
+/* An Empty Value Is Present, Unlike a Deleted Key, in the MemTable and on Disk Alike */
+void emptyValueTest() {
+    Options opt; opt.memTableBytes = 1 << 18;
+    LSM<uint64_t, string> lsm("./data_empty", opt);
+    lsm.reset();
+    uint64_t cnt = 0, total = 0, filler = 100;
+    auto check = [&]() {
+        string v = "x";
+        cnt += lsm.get(1, &v) && v.empty(); ++total;
+        cnt += !lsm.get(2, &v); ++total;
+    };
+    lsm.put(1, ""); lsm.put(2, "two"); lsm.remove(2);
+    check();
+    while (lsm.getStats().level[0].fileNum == 0) { lsm.put(filler++, string(100, 'f')); }
+    check();
+    cout << "Empty Value Test Result: " << cnt << '/' << total << " => " << double(cnt) / total * 100 << '%' << endl;
+}
+
+/* Ingest One File over Stored Keys and One Clear of Them, Then a Batch with a Truncated File, Which Must Add Nothing */
+void ingestTest(uint64_t size) {
+    LSM<uint64_t, string> lsm("./data_ingest");
+    lsm.reset();
+    uint64_t cnt = 0, total = 0;
+    auto writeFile = [](const string &filename, uint64_t begin, uint64_t end, const string &tag) {
+        SSTWriter<uint64_t, string> writer;
+        for (uint64_t i = begin; i < end; ++i) { writer.add(i, tag + to_string(i)); }
+        return writer.finish(filename);
+    };
+    /* An Empty Tag Means the Value put() Stored; absent Means No Value at All */
+    auto expect = [&](uint64_t begin, uint64_t end, const string &tag, bool absent = false) {
+        for (uint64_t i = begin; i < end; ++i) {
+            string v;
+            bool found = lsm.get(i, &v);
+            cnt += absent ? !found : found && v == tag + to_string(i); ++total;
+        }
+    };
+
+    for (uint64_t i = 0; i < size; ++i) { lsm.put(i, to_string(i)); }
+    cnt += writeFile("./ingest_over.bin", size / 4, size / 2, "o") && writeFile("./ingest_clear.bin", size, size * 5 / 4, "c"); ++total;
+    cnt += lsm.ingestFiles({"./ingest_over.bin", "./ingest_clear.bin"}); ++total;
+    expect(0, size / 4, "");
+    expect(size / 4, size / 2, "o");
+    expect(size / 2, size, "");
+    expect(size, size * 5 / 4, "c");
+    /* Ingested Files Are Copies, so Rewriting a Source Leaves the Store Alone */
+    cnt += writeFile("./ingest_over.bin", size / 4, size / 4 + 10, "r"); ++total;
+    expect(size / 4, size / 2, "o");
+
+    cnt += writeFile("./ingest_good.bin", size * 2, size * 9 / 4, "g") && writeFile("./ingest_bad.bin", size * 3, size * 13 / 4, "b"); ++total;
+    std::filesystem::resize_file("./ingest_bad.bin", std::filesystem::file_size("./ingest_bad.bin") / 2);
+    cnt += !lsm.ingestFiles({"./ingest_good.bin", "./ingest_bad.bin"}); ++total;
+    expect(size * 2, size * 9 / 4, "", true);
+    for (auto f : {"./ingest_over.bin", "./ingest_clear.bin", "./ingest_good.bin", "./ingest_bad.bin"}) { std::filesystem::remove(f); }
+    cout << "Ingest Test Result: " << cnt << '/' << total << " => " << double(cnt) / total * 100 << '%' << endl;
+}
+
+/* Readers on Several Threads Check Every Value They See Belongs to Its Key While Writes Force Flushes and Compactions */
+void concurrencyTest(uint64_t size, int readers) {
+    Options opt; opt.memTableBytes = 1 << 18;
+    LSM<uint64_t, string> lsm("./data_concurrent", opt);
+    lsm.reset();
+    atomic<uint64_t> cnt(0), total(0);
+    atomic<bool> stop(false);
+    auto belongs = [](uint64_t k, const string &v) { return v.compare(0, v.find('-'), to_string(k)) == 0; };
+
+    vector<thread> threads;
+    for (int t = 0; t < readers; ++t) {
+        threads.push_back(thread([&, t]() {
+            mt19937_64 rng(t);
+            uint64_t good = 0, seen = 0;
+            while (!stop) {
+                vector<uint64_t> keys;
+                for (int i = 0; i < 16; ++i) { keys.push_back(rng() % size); }
+                string v;
+                if (lsm.get(keys[0], &v)) { good += belongs(keys[0], v); ++seen; }
+                vector<pair<bool, string> > got = lsm.multiGet(keys);
+                for (size_t i = 0; i < keys.size(); ++i) {
+                    if (got[i].first) { good += belongs(keys[i], got[i].second); ++seen; }
+                }
+            }
+            cnt += good; total += seen;
+        }));
+    }
+
+    mt19937_64 rng(readers);
+    uint64_t compactions = lsm.getStats().latency[OP_COMPACT].getCount();
+    for (uint64_t i = 0; i < size * 8 || lsm.getStats().latency[OP_COMPACT].getCount() == compactions; ++i) {
+        uint64_t k = rng() % size;
+        uint64_t op = rng() % 100;
+        if (op == 0) { lsm.removeRange(k, k + 64); }
+        else if (op <= 20) { lsm.remove(k); }
+        else { lsm.put(k, to_string(k) + '-' + string(rng() % 64, 'v')); }
+    }
+    stop = true;
+    for (auto &t : threads) { t.join(); }
+    cout << "Concurrency Test Result: " << cnt << '/' << total << " => " << double(cnt) / total * 100 << '%' << endl;
+}
+
+/* Reopen a Store Intact, with a Stray SST the Manifest Does Not List, and with One of Its SSTs Truncated */
+void reopenTest(uint64_t size) {
+    Options opt; opt.memTableBytes = 1 << 18;
+    const string dir = "./data_reopen";
+    uint64_t cnt = 0, total = 0;
+    /* Keys in [skipLow, skipHigh] Are Not Checked */
+    auto check = [&](LSM<uint64_t, string> &lsm, uint64_t skipLow, uint64_t skipHigh) {
+        for (uint64_t i = 0; i < size; ++i) {
+            if (i >= skipLow && i <= skipHigh) { continue; }
+            string v;
+            bool found = lsm.get(i, &v);
+            cnt += i % 3 ? found && v == to_string(i) : !found; ++total;
+        }
+    };
+
+    {
+        LSM<uint64_t, string> lsm(dir, opt);
+        lsm.reset();
+        for (uint64_t i = 0; i < size; ++i) { lsm.put(i, to_string(i)); }
+        for (uint64_t i = 0; i < size; i += 3) { lsm.remove(i); }
+    }
+    { LSM<uint64_t, string> lsm(dir, opt); check(lsm, 1, 0); }
+
+    /* Newer than Everything, so Loading It Would Shadow Every Key */
+    string stray = dir + "/0-999999999.bin";
+    SSTWriter<uint64_t, string> writer;
+    for (uint64_t i = 0; i < size; ++i) { writer.add(i, "stale"); }
+    cnt += writer.finish(stray); ++total;
+    { LSM<uint64_t, string> lsm(dir, opt); check(lsm, 1, 0); }
+    cnt += !exists(stray); ++total;
+
+    string torn;
+    for (auto &entry : directory_iterator(dir)) {
+        uint32_t level; uint64_t number;
+        if (parseFilename(entry.path().filename().string(), &level, &number)) { torn = entry.path().string(); break; }
+    }
+    unique_ptr<Indices<uint64_t> > idx = loadIndices<uint64_t>(torn);
+    resize_file(torn, file_size(torn) / 2);
+    {
+        LSM<uint64_t, string> lsm(dir, opt);
+        cnt += lsm.getStats().badFiles == 1; ++total;
+        check(lsm, idx->getLowBound(), idx->getHighBound());
+    }
+    cnt += exists(torn + ".bad"); ++total;
+    cout << "Reopen Test Result: " << cnt << '/' << total << " => " << double(cnt) / total * 100 << '%' << endl;
+}
+
 struct Lat {
     double putLat;
     double getLat;
@@ -145,6 +330,12 @@ int main() {
     LSM<uint64_t, string> lsm("./data");
     // correctnessTest(lsm, TEST_SIZE);
     // latencyTest(lsm, TEST_SIZE);
+    emptyValueTest();
+    rangeDeleteTest(TEST_SIZE >> 4);
+    ingestTest(TEST_SIZE >> 4);
+    reopenTest(TEST_SIZE >> 4);
+    concurrencyTest(TEST_SIZE >> 6, 4);
     throughputTest(lsm, TEST_SIZE);
+    cout << endl << lsm.getStats().toString();
     return 0;
 }
\ No newline at end of file